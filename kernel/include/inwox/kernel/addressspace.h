@@ -49,10 +49,13 @@
  * +-----------------------------------------+-----+-+-+-+-+-+-+-+-+-+
  * 31                                        11    9                 0
  * 分为已分配（PAGE_PRESENT）可写（PAGE_WRITABLE）用户态可用（PAGE_USER）
+ * 另外使用Avail中的一位标识写时复制（PAGE_COW），此类页被多个地址空间共享，以只读方式映射，
+ * 写入时触发缺页异常再复制
  */
 #define PAGE_PRESENT   (1 << 0)
 #define PAGE_WRITABLE  (1 << 1)
 #define PAGE_USER      (1 << 2)
+#define PAGE_COW       (1 << 9)
 
 /**
  * 获取linker.ld中
@@ -83,16 +86,23 @@ class AddressSpace {
 public:
     AddressSpace();
     ~AddressSpace();
+    static void *operator new(size_t size);
+    static void operator delete(void *object);
     static void initialize();
+    static void zeroPhysicalPage(inwox_phy_addr_t physicalAddress);
+    static void mapSharedData(inwox_phy_addr_t physicalAddress);
     void activate();
     AddressSpace *fork();
     inwox_phy_addr_t getPhysicalAddress(inwox_vir_addr_t virtualAddress);
+    bool handlePageFault(inwox_vir_addr_t address, uint32_t errorCode);
     inwox_vir_addr_t mapAt(inwox_vir_addr_t virtualAddress, inwox_phy_addr_t physicalAddress, int protection);
     inwox_vir_addr_t mapFromOtherAddressSpace(AddressSpace *sourceSpace, inwox_vir_addr_t sourceVirtualAddress,
                                               size_t size, int protection);
     inwox_vir_addr_t mapMemory(size_t size, int protection);
     inwox_vir_addr_t mapMemory(inwox_vir_addr_t virtualAddress, size_t size, int protection);
     inwox_vir_addr_t mapPhysical(inwox_phy_addr_t physicalAddress, size_t size, int protection);
+    inwox_vir_addr_t remapMemory(inwox_vir_addr_t virtualAddress, size_t oldSize, size_t newSize, int flags);
+    inwox_vir_addr_t reserveMemory(size_t size, int protection);
     void unMap(inwox_vir_addr_t virtualAddress);
     void unmapMemory(inwox_vir_addr_t virtualAddress, size_t size);
     void unmapPhysical(inwox_vir_addr_t firstVirtualAddress, size_t size);
@@ -102,10 +112,23 @@ public:
      * 每个进程都有自己独立的段空间，使用链表进行管理，根据首个段可以遍历整个地址空间
      */
     MemorySegment *firstSegment;
+    /**
+     * 同一组段按地址组织成的平衡树的根，用于查找段、空闲空间以及插入删除
+     */
+    MemorySegment *segmentTree;
+    /**
+     * 保护本地址空间的段树和页表，不同地址空间的操作互不阻塞，操作段树时必须持有
+     */
+    kthread_mutex_t mutex;
 
 private:
     inwox_vir_addr_t mapAt(size_t pdIndex, size_t ptIndex, inwox_phy_addr_t physicalAddress, int flags);
     inwox_vir_addr_t mapAtWithFlags(size_t pdIndex, size_t ptIndex, inwox_phy_addr_t physicalAddress, int flags);
+    bool commitMemory(inwox_vir_addr_t virtualAddress, size_t size, int protection);
+    uintptr_t getPageEntry(inwox_vir_addr_t virtualAddress);
+    void releaseMemory(inwox_vir_addr_t virtualAddress, size_t size);
+    bool copyOnWrite(inwox_vir_addr_t address);
+    bool mapOnDemand(inwox_vir_addr_t address, bool write);
 
 private:
     /**
@@ -123,7 +146,6 @@ private:
      */
     AddressSpace *prev;
     AddressSpace *next;
-    kthread_mutex_t mutex;
 
 private:
     static AddressSpace _kernelSpace;
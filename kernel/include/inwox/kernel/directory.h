@@ -35,6 +35,8 @@ class DirectoryVnode : public Vnode {
 public:
     DirectoryVnode(DirectoryVnode *parent, mode_t mode, dev_t dev, ino_t ino);
     ~DirectoryVnode();
+    static void *operator new(size_t size);
+    static void operator delete(void *object);
     void addChildNode(const char *path, Vnode *vnode);
     virtual Vnode *getChildNode(const char *path);
     virtual ssize_t readdir(unsigned long offset, void *buffer, size_t size);
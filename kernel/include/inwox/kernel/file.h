@@ -34,6 +34,8 @@ class FileVnode : public Vnode {
 public:
     FileVnode(const void *data, size_t size, mode_t mode, dev_t dev, ino_t ino);
     ~FileVnode();
+    static void *operator new(size_t size);
+    static void operator delete(void *object);
     virtual int ftruncate(off_t length);
     virtual bool isSeekable();
     virtual ssize_t pread(void *buffer, size_t size, off_t offset);
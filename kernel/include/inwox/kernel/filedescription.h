@@ -33,6 +33,8 @@
 class FileDescription {
 public:
     FileDescription(Vnode *vnode);
+    static void *operator new(size_t size);
+    static void operator delete(void *object);
     FileDescription *openat(const char *path, int flags, mode_t mode);
     ssize_t read(void *buffer, size_t size);
     ssize_t readdir(unsigned long offset, void *buffer, size_t size);
@@ -131,6 +131,7 @@ extern void isr_47(void); /* Secondary ATA Hard Disk */
 extern void isr_48(void);         /* Padding */
 extern void isr_49(void);         /* Schedule */
 extern void syscallHandler(void); /* Syscall */
+extern void sysenterHandler(void); /* Syscall (sysenter) */
 }
 
 /**
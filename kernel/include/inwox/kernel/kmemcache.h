@@ -0,0 +1,63 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * kernel/include/inwox/kernel/kmemcache.h
+ * 内核对象缓存，为固定大小的内核对象提供slab分配
+ */
+
+#ifndef KERNEL_KMEMCACHE_H_
+#define KERNEL_KMEMCACHE_H_
+
+#include <stddef.h>
+#include <inwox/kernel/kthread.h>
+
+/**
+ * 固定大小内核对象的缓存
+ * 
+ * 每种对象一个缓存，缓存从内核地址空间按slab（若干页）申请内存，并将其划分为等长的对象。空闲对象通过
+ * 其首个字连成单向链表，分配和释放都是O(1)，不需要像malloc那样遍历空闲块，也不需要块头。
+ * 需要使用缓存的类定义自己的operator new和operator delete，并在其中调用allocate和free
+ */
+class KmemCache {
+public:
+    KmemCache(const char *name, size_t objectSize);
+    void *allocate();
+    void free(void *object);
+
+private:
+    bool grow();
+
+public:
+    const char *name;
+    size_t objectSize;
+    size_t slabSize;
+    size_t totalCount; /* 缓存中对象总数 */
+    size_t freeCount;  /* 空闲对象个数 */
+
+private:
+    void *freeList;
+    kthread_mutex_t mutex;
+};
+
+#endif /* KERNEL_KMEMCACHE_H_ */
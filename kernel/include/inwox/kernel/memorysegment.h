@@ -32,8 +32,14 @@
 #include <inwox/kernel/inwox.h>
 
 #define SEG_NOUNMAP (1 << 16)
+/* 段只预留虚拟地址，物理内存在首次访问时由缺页异常分配 */
+#define SEG_LAZY    (1 << 17)
 #define PAGESIZE 0x1000
 
+/**
+ * 内存段，每个地址空间的全部段组成一棵按地址排序的平衡二叉树（AVL树），同时通过prev和next按地址顺序连成链表
+ * 每个节点记录其子树中最大的空闲空间（某段结束到下一段开始之间的空间），查找空闲空间、插入、删除都是O(log n)
+ */
 class MemorySegment {
 public:
     MemorySegment(inwox_vir_addr_t address, size_t size, int flags, MemorySegment *prev, MemorySegment *next);
@@ -45,17 +51,35 @@ public:
     MemorySegment *prev;
     MemorySegment *next;
 
+private:
+    MemorySegment *parent;
+    MemorySegment *left;
+    MemorySegment *right;
+    size_t maxGap;
+    int height;
+
 public:
-    static void addSegment(MemorySegment *firstSegment, inwox_vir_addr_t address, size_t size, int protection);
-    static void removeSegment(MemorySegment *firstSegment, inwox_vir_addr_t address, size_t size);
-    static inwox_vir_addr_t findAndAddNewSegment(MemorySegment *firstSegment, size_t size, int protection);
+    static void addSegment(MemorySegment *&tree, MemorySegment *newSegment);
+    static void addSegment(MemorySegment *&tree, inwox_vir_addr_t address, size_t size, int protection);
+    static void removeSegment(MemorySegment *&tree, inwox_vir_addr_t address, size_t size);
+    static inwox_vir_addr_t findAndAddNewSegment(MemorySegment *&tree, size_t size, int protection);
+    static MemorySegment *findSegment(MemorySegment *tree, inwox_vir_addr_t address);
+    static bool extendSegment(MemorySegment *segment, size_t size);
 
 private:
-    static void addSegment(MemorySegment *firstSegment, MemorySegment *newSegment);
+    static void insertSegment(MemorySegment *&tree, MemorySegment *newSegment);
+    static void eraseSegment(MemorySegment *&tree, MemorySegment *segment);
+    static void replaceChild(MemorySegment *&tree, MemorySegment *parent, MemorySegment *oldChild,
+                             MemorySegment *newChild);
+    static void updateNode(MemorySegment *segment);
+    static void updatePath(MemorySegment *segment);
+    static MemorySegment *rotateLeft(MemorySegment *&tree, MemorySegment *segment);
+    static MemorySegment *rotateRight(MemorySegment *&tree, MemorySegment *segment);
+    static void rebalance(MemorySegment *&tree, MemorySegment *segment);
     static MemorySegment *allocateSegment(inwox_vir_addr_t address, size_t size, int flags);
     static void deallocateSegment(MemorySegment *segment);
-    static inwox_vir_addr_t findFreeSegment(MemorySegment *segment, size_t size);
-    static void verifySegmentList();
+    static inwox_vir_addr_t findFreeSegment(MemorySegment *tree, size_t size);
+    static void growSegmentCache(MemorySegment *&tree);
 };
 
 #endif /* KERNEL_MEMORYSEGMENT_H_ */
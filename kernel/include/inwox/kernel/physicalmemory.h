@@ -32,10 +32,25 @@
 #include <inwox/kernel/multiboot.h> /* multiboot_info */
 #include <inwox/kernel/inwox.h>     /* inwox_phy_addr_t */
 
+/* buddy分配器的最大阶数，最大可以分配2^10页即4M的连续物理内存 */
+#define BUDDY_MAX_ORDER 10
+
 namespace PhysicalMemory {
 void initialize(multiboot_info *multiboot);
 void pushPageFrame(inwox_phy_addr_t physicalAddress);
 inwox_phy_addr_t popPageFrame();
+bool popPageFrames(size_t count, inwox_phy_addr_t *frameList);
+void pushPageFrames(size_t count, const inwox_phy_addr_t *frameList);
+inwox_phy_addr_t popZeroedPageFrame();
+bool popZeroedPageFrames(size_t count, inwox_phy_addr_t *frameList);
+inwox_phy_addr_t allocContiguous(unsigned int order);
+void freeContiguous(inwox_phy_addr_t physicalAddress, unsigned int order);
+void retainPageFrame(inwox_phy_addr_t physicalAddress);
+void releasePageFrame(inwox_phy_addr_t physicalAddress);
+void releasePageFrames(size_t count, inwox_phy_addr_t *frameList);
+bool isPageFrameShared(inwox_phy_addr_t physicalAddress);
+bool hasBackgroundWork();
+bool doBackgroundWork();
 } /* namespace PhysicalMemory */
 
 #endif /* KERNEL_PHYSICALMEMORY_H_ */
@@ -38,11 +38,15 @@
 #include <inwox/kernel/kthread.h>
 
 #define OPEN_MAX 20
+/* fxsave保存的x87/MMX/SSE寄存器状态大小 */
+#define FPU_STATE_SIZE 512
 
 class Process {
 public:
     Process();
     ~Process();
+    static void *operator new(size_t size);
+    static void operator delete(void *object);
     void exit(int status);
     Process *regfork(int flags, struct regfork *registers);
     int execute(Vnode *vnode, char *const argv[], char *const envp[]);
@@ -61,6 +65,8 @@ private:
     Process **children;
     size_t numChildren;
     kthread_mutex_t childrenMutex;
+    /* 用户程序的SSE寄存器，进程切换时保存和恢复，fxsave要求16字节对齐 */
+    char fpuState[FPU_STATE_SIZE] ALIGNED(16);
 
 public:
     AddressSpace *addressSpace;    /* 每个进程都有自己独立的地址空间 */
@@ -35,6 +35,7 @@
 #include <sys/types.h>
 #include <sys/utsname.h>
 #include <inwox/fork.h>
+#include <inwox/ring.h>
 #include <inwox/syscall.h>
 #include <inwox/timespec.h>
 
@@ -46,6 +47,7 @@ ssize_t read(int fd, void *buffer, size_t size);
 ssize_t write(int fd, const void *buffer, size_t size);
 void *mmap(__mmapRequest *request);
 int munmap(void *addr, size_t size);
+void *mremap(void *oldAddress, size_t oldSize, size_t newSize, int flags);
 int openat(int fd, const char *path, int flags, mode_t mode);
 int close(int fd);
 pid_t regfork(int flags, struct regfork *registers);
@@ -59,6 +61,7 @@ int tcgetattr(int fd, struct termios *result);
 int tcsetattr(int fd, int flags, const struct termios *termio);
 int fchdirat(int dirfd, const char *path);
 int uname(struct utsname *uname);
+int ring_enter(struct ring *ring, unsigned int count);
 void badSyscall();
 } /* namespace Syscall */
 
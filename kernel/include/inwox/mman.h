@@ -47,6 +47,11 @@
 
 #define MAP_FAILED ((void *)0)
 
+/**
+ * mremap的flags
+ */
+#define MREMAP_MAYMOVE (1 << 0) /* 原地址之后空间不足时，允许将映射移动到新的地址 */
+
 #if defined(__is_inwox_kernel) || defined(__is_inwox_libc)
 #include <stddef.h>
 #include <inwox/types.h>
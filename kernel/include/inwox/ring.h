@@ -0,0 +1,68 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* kernel/include/inwox/ring.h
+ * 批量系统调用的提交/完成环
+ */
+
+#ifndef INWOX_RING_H_
+#define INWOX_RING_H_
+
+#include <stdint.h>
+
+/**
+ * 提交项，描述一次系统调用
+ */
+struct ring_sqe {
+    uint32_t sqe_syscall;    // 系统调用号，见inwox/syscall.h
+    uintptr_t sqe_args[5];   // 参数，与int 0x49时的%ebx、%ecx、%edx、%esi、%edi依次对应
+    uintptr_t sqe_userdata;  // 原样写入对应的完成项，用于区分完成的是哪一项
+};
+
+/**
+ * 完成项，保存一次系统调用的结果
+ */
+struct ring_cqe {
+    uintptr_t cqe_userdata;  // 对应提交项的sqe_userdata
+    intptr_t cqe_result;     // 系统调用返回值
+    int cqe_errno;           // 系统调用设置的错误码，成功时为0
+};
+
+/**
+ * 提交环和完成环，由用户程序分配在自己的地址空间中，内核在ring_enter时直接读写
+ *
+ * 两个环都有r_entries项，r_entries必须是2的幂，head和tail只增不减，取下标时与r_entries - 1相与
+ * 用户程序在r_sq[r_sqtail]填写提交项后增加r_sqtail，内核执行后增加r_sqhead；
+ * 内核在r_cq[r_cqtail]写入完成项后增加r_cqtail，用户程序读取后增加r_cqhead
+ */
+struct ring {
+    uint32_t r_entries;
+    volatile uint32_t r_sqhead;
+    volatile uint32_t r_sqtail;
+    volatile uint32_t r_cqhead;
+    volatile uint32_t r_cqtail;
+    struct ring_sqe *r_sq;
+    struct ring_cqe *r_cq;
+};
+
+#endif /* INWOX_RING_H_ */
@@ -48,7 +48,9 @@
 #define SYSCALL_FCHDIRAT  16
 #define SYSCALL_UNAME 17
 #define SYSCALL_FSTAT 18
+#define SYSCALL_MREMAP 19
+#define SYSCALL_RING_ENTER 20
 
-#define NUM_SYSCALLS 19
+#define NUM_SYSCALLS 21
 
 #endif /* INWOX_SYSCALL_H_ */
@@ -28,6 +28,7 @@
 #ifndef INWOX_TYPES_H_
 #define INWOX_TYPES_H_
 
+typedef int __clockid_t;
 typedef unsigned long __dev_t;
 typedef __UINTMAX_TYPE__ __ino_t;
 typedef int __mode_t;
@@ -0,0 +1,61 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * kernel/include/inwox/vdata.h
+ * 内核与用户程序共享的只读数据页
+ */
+
+#ifndef INWOX_VDATA_H_
+#define INWOX_VDATA_H_
+
+#include <stdint.h>
+#include <inwox/types.h>
+
+/**
+ * 数据页在所有地址空间中的地址，位于内核空间，但页表项允许用户态读取
+ */
+#define VDATA_ADDRESS 0xFF000000
+
+/**
+ * 内核在时钟中断中更新时间，使用顺序锁（seqlock）发布：更新前后各将sequence加一，
+ * 读者在sequence为偶数且读取前后不变时得到的数据才是一致的，读者不需要进入内核
+ */
+struct vdata {
+    volatile uint32_t sequence;
+    /* 每次时钟中断经过的纳秒数 */
+    uint32_t nsPerTick;
+    /* 开机起的时钟中断次数 */
+    uint64_t ticks;
+    /* 最近一次时钟中断时的TSC */
+    uint64_t tscAtTick;
+    /* 距上次时钟中断的纳秒数 = (TSC差值 * tscScale) >> tscShift，tscScale为0时只按时钟中断计时 */
+    uint32_t tscScale;
+    uint32_t tscShift;
+    /* 开机时刻距1970-01-01的秒数（UTC），开机时从CMOS实时时钟读取 */
+    __time_t bootTime;
+    /* 正在运行的进程，只有一个CPU，用户程序读到的就是自己的pid */
+    __pid_t pid;
+};
+
+#endif /* INWOX_VDATA_H_ */
@@ -30,7 +30,9 @@
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
+#include <inwox/vdata.h>
 #include <inwox/kernel/addressspace.h>
+#include <inwox/kernel/kmemcache.h>
 #include <inwox/kernel/physicalmemory.h>
 #include <inwox/kernel/print.h>
 #include <inwox/kernel/process.h>
@@ -67,11 +69,39 @@ static inline int protectionToFlags(int protection)
     return flags;
 }
 
-static inwox_vir_addr_t mapTemporarily(inwox_phy_addr_t physicalAddress, int protection)
+/**
+ * 临时映射使用的两个虚拟页，用于访问不常驻内存的用户页表及物理页，使用时需持有temporaryMutex
+ * fork和写时复制需要同时访问两个页，所以预留了两个位置
+ * 另有一页专门用于将物理页清零，使用时需持有zeroMutex，这样清零不会与使用临时映射的操作互相等待
+ * 临时映射有自己的锁而不使用kernelSpace->mutex，这样内核堆增长等内核地址空间的操作不会阻塞用户地址空间的操作
+ */
+#define TEMPORARY_MAPPING       0xFF7FF000
+#define TEMPORARY_MAPPING_EXTRA 0xFF7FE000
+#define TEMPORARY_MAPPING_ZERO  0xFF7FD000
+
+static kthread_mutex_t temporaryMutex = KTHREAD_MUTEX_INITIALIZER;
+static kthread_mutex_t zeroMutex = KTHREAD_MUTEX_INITIALIZER;
+
+static inwox_vir_addr_t mapTemporarily(inwox_phy_addr_t physicalAddress, int protection,
+                                       inwox_vir_addr_t mapping = TEMPORARY_MAPPING)
 {
-    return kernelSpace->mapAt(0xFF7FF000, physicalAddress, protection);
+    return kernelSpace->mapAt(mapping, physicalAddress, protection);
 }
 
+/**
+ * 缺页异常错误码
+ * PF_PRESENT为1表示访问了已存在的页（权限错误），为0表示页不存在
+ * PF_WRITE为1表示写操作引发的异常
+ */
+#define PF_PRESENT (1 << 0)
+#define PF_WRITE   (1 << 1)
+
+/**
+ * 批量分配、归还物理页时每批的页数，每批只需对物理内存管理器加锁一次
+ * 页号数组放在内核栈上，不宜过大
+ */
+#define FRAME_BATCH 32
+
 /**
  * @brief 创建一个新的地址空间
  * 
@@ -88,6 +118,7 @@ AddressSpace::AddressSpace()
         pageDir = 0;
         pageDirMapped = RECURSIVE_MAPPING + 0x3FF000; // FFFFF000为4G地址空间的最后4K，存放页目录
         firstSegment = nullptr;
+        segmentTree = nullptr;
         prev = nullptr;
         next = nullptr;
     } else {
@@ -97,8 +128,10 @@ AddressSpace::AddressSpace()
         pageDirMapped = kernelSpace->mapPhysical(pageDir, PAGESIZE, PROT_READ | PROT_WRITE);
 
         // 创建地址空间时，会为此地址空间创建一个segment
-        firstSegment = new MemorySegment(0, PAGESIZE, PROT_NONE | SEG_NOUNMAP, nullptr, nullptr);
-        MemorySegment::addSegment(firstSegment, 0xC0000000, -0xC0000000, PROT_NONE | SEG_NOUNMAP);
+        segmentTree = nullptr;
+        MemorySegment::addSegment(segmentTree, 0, PAGESIZE, PROT_NONE | SEG_NOUNMAP);
+        MemorySegment::addSegment(segmentTree, 0xC0000000, -0xC0000000, PROT_NONE | SEG_NOUNMAP);
+        firstSegment = MemorySegment::findSegment(segmentTree, 0);
 
         ScopedLock lock(&listMutex);
         memcpy((void *)pageDirMapped, (const void *)kernelPageDir, PAGESIZE);
@@ -141,9 +174,44 @@ AddressSpace::~AddressSpace()
         }
         currentSegment = next;
     }
+    // 构造时预留的两个段不对应内存，只需将段描述符归还
+    kthread_mutex_lock(&mutex);
+    MemorySegment::removeSegment(segmentTree, 0, PAGESIZE);
+    MemorySegment::removeSegment(segmentTree, 0xC0000000, -0xC0000000);
+    kthread_mutex_unlock(&mutex);
+    // 用户部分的页表是本地址空间独有的，内核部分的页表与其他地址空间共用，不能释放
+    uintptr_t *pageDirectory = (uintptr_t *)pageDirMapped;
+    inwox_phy_addr_t frameList[FRAME_BATCH];
+    size_t frameCount = 0;
+    for (size_t pdIndex = 0; pdIndex < 0x300; pdIndex++) {
+        if (pageDirectory[pdIndex] & PAGE_PRESENT) {
+            frameList[frameCount++] = pageDirectory[pdIndex] & ~0xFFF;
+            if (frameCount == FRAME_BATCH) {
+                PhysicalMemory::pushPageFrames(frameCount, frameList);
+                frameCount = 0;
+            }
+        }
+    }
+    PhysicalMemory::pushPageFrames(frameCount, frameList);
+    kernelSpace->unmapPhysical(pageDirMapped, PAGESIZE);
     PhysicalMemory::pushPageFrame(pageDir);
 }
 
+/**
+ * 地址空间对象从专用的对象缓存分配，内核地址空间是静态对象，不经过此缓存
+ */
+static KmemCache addressSpaceCache("addressspace", sizeof(AddressSpace));
+
+void *AddressSpace::operator new(size_t /* size */)
+{
+    return addressSpaceCache.allocate();
+}
+
+void AddressSpace::operator delete(void *object)
+{
+    addressSpaceCache.free(object);
+}
+
 /**
  * 需要在编译期先声明如下的段，因为在内存管理初始化前就要用到
  */
@@ -155,7 +223,9 @@ static MemorySegment readOnlySegment((inwox_vir_addr_t) &kernelVirtualBegin,
 static MemorySegment writableSegment((inwox_vir_addr_t)&kernelReadOnlyEnd,
                               (inwox_vir_addr_t)&kernelVirtualEnd - (inwox_vir_addr_t)&kernelReadOnlyEnd,
                               PROT_READ | PROT_WRITE, &readOnlySegment, nullptr);
-static MemorySegment temporarySegment(0xFF7FF000, PAGESIZE, PROT_NONE, &writableSegment, nullptr);
+// VDATA_ADDRESS所在的4M只放共享数据页，其页表允许用户访问
+static MemorySegment sharedDataSegment(VDATA_ADDRESS, 0x400000, PROT_READ, &writableSegment, nullptr);
+static MemorySegment temporarySegment(TEMPORARY_MAPPING_ZERO, 3 * PAGESIZE, PROT_NONE, &sharedDataSegment, nullptr);
 // 紧挨着页目录页表的4M为物理内存段
 static MemorySegment physicalMemorySegment(RECURSIVE_MAPPING - 0x400000, 0x400000, PROT_READ | PROT_WRITE, &temporarySegment, nullptr);
 static MemorySegment recursiveMappingSegment(RECURSIVE_MAPPING, -RECURSIVE_MAPPING, PROT_READ | PROT_WRITE, &physicalMemorySegment, nullptr);
@@ -213,12 +283,38 @@ void AddressSpace::initialize()
     // 对分页系统的访问不能使用虚拟地址，否则会产生死循环
     kernelSpace->unMap(RECURSIVE_MAPPING);
     kernelSpace->firstSegment = &userSegment;
-    userSegment.next = &videoSegment;
-    videoSegment.next = &readOnlySegment;
-    readOnlySegment.next = &writableSegment;
-    writableSegment.next = &temporarySegment;
-    temporarySegment.next = &physicalMemorySegment;
-    physicalMemorySegment.next = &recursiveMappingSegment;
+    MemorySegment::addSegment(kernelSpace->segmentTree, &userSegment);
+    MemorySegment::addSegment(kernelSpace->segmentTree, &videoSegment);
+    MemorySegment::addSegment(kernelSpace->segmentTree, &readOnlySegment);
+    MemorySegment::addSegment(kernelSpace->segmentTree, &writableSegment);
+    MemorySegment::addSegment(kernelSpace->segmentTree, &sharedDataSegment);
+    MemorySegment::addSegment(kernelSpace->segmentTree, &temporarySegment);
+    MemorySegment::addSegment(kernelSpace->segmentTree, &physicalMemorySegment);
+    MemorySegment::addSegment(kernelSpace->segmentTree, &recursiveMappingSegment);
+}
+
+/**
+ * @brief 将物理页以只读方式映射到VDATA_ADDRESS，所有地址空间的用户程序都可以读取
+ *
+ * 内核部分的页表为所有地址空间共用，因此只需映射一次，再给所有页目录中对应的项加上PAGE_USER，
+ * 该页表中只有这一页带有PAGE_USER，内核的其他内存仍然不能被用户访问
+ *
+ * @param physicalAddress 数据页的物理地址
+ */
+void AddressSpace::mapSharedData(inwox_phy_addr_t physicalAddress)
+{
+    size_t pdIndex;
+    size_t ptIndex;
+    addressToIndex(VDATA_ADDRESS, pdIndex, ptIndex);
+    kthread_mutex_lock(&kernelSpace->mutex);
+    kernelSpace->mapAtWithFlags(pdIndex, ptIndex, physicalAddress, PAGE_PRESENT | PAGE_USER);
+    kthread_mutex_unlock(&kernelSpace->mutex);
+
+    ScopedLock lock(&listMutex);
+    ((uintptr_t *)kernelSpace->pageDirMapped)[pdIndex] |= PAGE_USER;
+    for (AddressSpace *addressSpace = firstAddressSpace; addressSpace; addressSpace = addressSpace->next) {
+        ((uintptr_t *)addressSpace->pageDirMapped)[pdIndex] |= PAGE_USER;
+    }
 }
 
 /**
@@ -236,33 +332,245 @@ static kthread_mutex_t forkMutex = KTHREAD_MUTEX_INITIALIZER;
 /**
  * @brief fork地址空间
  * 
- * 启动新进程时，fork父进程地址空间
- * 1. 创建一个新的地址空间
- * 2. 复制原地址空间内存
- * @return AddressSpace* 新地址空间
+ * 启动新进程时，fork父进程地址空间，使用写时复制，不再复制内存内容
+ * 1. 创建一个新的地址空间，并复制父进程的段信息
+ * 2. 为新地址空间复制用户部分的页表，两者共享全部物理页，并增加物理页的引用计数
+ * 3. 可写页在两个地址空间中都改为只读并标记PAGE_COW，任意一方写入时在缺页异常中复制
+ * 这样fork的开销只与页表大小相关，而与进程占用的内存大小无关
+ * 分配页表失败时撤销已复制的页表，父进程中已改为PAGE_COW的页在写入时会发现没有共享而直接恢复可写
+ * @return AddressSpace* 新地址空间，内存不足时返回nullptr
  */
 AddressSpace *AddressSpace::fork()
 {
     ScopedLock lock(&forkMutex);
     AddressSpace *result = new AddressSpace();
+    kthread_mutex_lock(&mutex);
+    kthread_mutex_lock(&result->mutex);
     MemorySegment *segment = firstSegment->next;
     while (segment) {
-        // 找到未使用的segment，分配并复制父进程的地址空间内容
         if (!(segment->flags & SEG_NOUNMAP)) {
-            size_t size = segment->size;
-            result->mapMemory(segment->address, size, segment->flags);
-            inwox_vir_addr_t source = kernelSpace->mapFromOtherAddressSpace(this, segment->address, size, PROT_READ);
-            inwox_vir_addr_t dest = kernelSpace->mapFromOtherAddressSpace(result, segment->address, size, PROT_WRITE);
-            memcpy((void *)dest, (const void *)source, size);
-            kernelSpace->unmapPhysical(source, size);
-            kernelSpace->unmapPhysical(dest, size);
+            MemorySegment::addSegment(result->segmentTree, segment->address, segment->size, segment->flags);
         }
         segment = segment->next;
     }
 
+    uintptr_t *pageDirectory = (uintptr_t *)pageDirMapped;
+    uintptr_t *newPageDirectory = (uintptr_t *)result->pageDirMapped;
+    // 0xC0000000以上为内核空间，创建地址空间时已经复制，先统计需要复制的页表数目，以便批量分配
+    size_t pageTableCount = 0;
+    for (size_t pdIndex = 0; pdIndex < 0x300; pdIndex++) {
+        if (pageDirectory[pdIndex] & PAGE_PRESENT) {
+            pageTableCount++;
+        }
+    }
+    inwox_phy_addr_t frameList[FRAME_BATCH];
+    size_t framesLeft = 0;
+    bool success = true;
+
+    kthread_mutex_lock(&temporaryMutex);
+    for (size_t pdIndex = 0; pdIndex < 0x300; pdIndex++) {
+        if (!(pageDirectory[pdIndex] & PAGE_PRESENT)) {
+            continue;
+        }
+        if (!framesLeft) {
+            framesLeft = pageTableCount < FRAME_BATCH ? pageTableCount : FRAME_BATCH;
+            if (!PhysicalMemory::popPageFrames(framesLeft, frameList)) {
+                framesLeft = 0;
+                success = false;
+                break;
+            }
+            pageTableCount -= framesLeft;
+        }
+        inwox_phy_addr_t newPageTablePhys = frameList[--framesLeft];
+        uintptr_t *pageTable = (uintptr_t *)mapTemporarily(pageDirectory[pdIndex] & ~0xFFF,
+                                                           PROT_READ | PROT_WRITE);
+        uintptr_t *newPageTable = (uintptr_t *)mapTemporarily(newPageTablePhys, PROT_READ | PROT_WRITE,
+                                                              TEMPORARY_MAPPING_EXTRA);
+        for (size_t ptIndex = 0; ptIndex < 1024; ptIndex++) {
+            uintptr_t entry = pageTable[ptIndex];
+            if (!(entry & PAGE_PRESENT)) {
+                newPageTable[ptIndex] = 0;
+                continue;
+            }
+            if (entry & PAGE_WRITABLE) {
+                entry = (entry & ~PAGE_WRITABLE) | PAGE_COW;
+                pageTable[ptIndex] = entry;
+            }
+            newPageTable[ptIndex] = entry;
+            PhysicalMemory::retainPageFrame(entry & ~0xFFF);
+        }
+        newPageDirectory[pdIndex] = newPageTablePhys | (pageDirectory[pdIndex] & 0xFFF);
+        kernelSpace->unMap((inwox_vir_addr_t)newPageTable);
+        kernelSpace->unMap((inwox_vir_addr_t)pageTable);
+    }
+
+    // 内存不足，归还已复制页表引用的物理页和页表本身，子地址空间不能只有一部分页表
+    for (size_t pdIndex = 0; !success && pdIndex < 0x300; pdIndex++) {
+        if (!(newPageDirectory[pdIndex] & PAGE_PRESENT)) {
+            continue;
+        }
+        inwox_phy_addr_t pageTablePhys = newPageDirectory[pdIndex] & ~0xFFF;
+        uintptr_t *newPageTable = (uintptr_t *)mapTemporarily(pageTablePhys, PROT_READ);
+        size_t frameCount = 0;
+        for (size_t ptIndex = 0; ptIndex < 1024; ptIndex++) {
+            if (newPageTable[ptIndex] & PAGE_PRESENT) {
+                frameList[frameCount++] = newPageTable[ptIndex] & ~0xFFF;
+                if (frameCount == FRAME_BATCH) {
+                    PhysicalMemory::releasePageFrames(frameCount, frameList);
+                    frameCount = 0;
+                }
+            }
+        }
+        PhysicalMemory::releasePageFrames(frameCount, frameList);
+        kernelSpace->unMap((inwox_vir_addr_t)newPageTable);
+        newPageDirectory[pdIndex] = 0;
+        PhysicalMemory::pushPageFrame(pageTablePhys);
+    }
+    kthread_mutex_unlock(&temporaryMutex);
+    kthread_mutex_unlock(&result->mutex);
+    kthread_mutex_unlock(&mutex);
+
+    // 父地址空间中的可写页已改为只读，若其正被使用，需要刷新整个TLB
+    uintptr_t cr3;
+    __asm__ __volatile__("mov %%cr3, %0" : "=r"(cr3));
+    if (cr3 == pageDir) {
+        activate();
+    }
+
+    if (!success) {
+        delete result;
+        return nullptr;
+    }
     return result;
 }
 
+/**
+ * @brief 处理本地址空间中的缺页异常
+ * 
+ * 可以处理两类缺页异常：
+ * 1. 访问SEG_LAZY段中还未分配物理内存的页，此时按需分配一页清零的物理内存
+ * 2. 写入标记了PAGE_COW的页，此时进行写时复制
+ * 本地址空间必须是当前激活的地址空间
+ * 
+ * @param address 引发异常的虚拟地址（%cr2）
+ * @param errorCode CPU压入的缺页异常错误码
+ * @return true 异常已处理，可以返回重新执行引发异常的指令
+ * @return false 非法访问，无法处理
+ */
+bool AddressSpace::handlePageFault(inwox_vir_addr_t address, uint32_t errorCode)
+{
+    if (this == kernelSpace || address >= 0xC0000000) {
+        return false;
+    }
+    address &= ~0xFFF;
+
+    ScopedLock lock(&mutex);
+    if (!(errorCode & PF_PRESENT)) {
+        return mapOnDemand(address, errorCode & PF_WRITE);
+    }
+    if (errorCode & PF_WRITE) {
+        return copyOnWrite(address);
+    }
+    return false;
+}
+
+/**
+ * @brief 写时复制
+ * 
+ * 若物理页仍被共享，则分配新页并复制内容，否则该页只剩当前使用者，直接恢复可写即可
+ * 
+ * @param address 被写入的页，4K对齐
+ * @return true 已复制或恢复可写
+ * @return false 该页不是写时复制页，或没有可用内存
+ */
+bool AddressSpace::copyOnWrite(inwox_vir_addr_t address)
+{
+    size_t pdIndex, ptIndex;
+    addressToIndex(address, pdIndex, ptIndex);
+    uintptr_t *pageDirectory = (uintptr_t *)pageDirMapped;
+    if (!(pageDirectory[pdIndex] & PAGE_PRESENT)) {
+        return false;
+    }
+
+    kthread_mutex_lock(&temporaryMutex);
+    uintptr_t *pageTable = (uintptr_t *)mapTemporarily(pageDirectory[pdIndex] & ~0xFFF, PROT_READ | PROT_WRITE);
+    uintptr_t entry = pageTable[ptIndex];
+    bool handled = false;
+    if (entry & PAGE_COW) {
+        inwox_phy_addr_t physicalAddress = entry & ~0xFFF;
+        if (PhysicalMemory::isPageFrameShared(physicalAddress)) {
+            inwox_phy_addr_t copyPhys = PhysicalMemory::popPageFrame();
+            if (copyPhys) {
+                // 原页在当前地址空间仍可读，直接从引发异常的地址复制
+                void *copy = (void *)mapTemporarily(copyPhys, PROT_READ | PROT_WRITE, TEMPORARY_MAPPING_EXTRA);
+                memcpy(copy, (const void *)address, PAGESIZE);
+                kernelSpace->unMap((inwox_vir_addr_t)copy);
+                PhysicalMemory::releasePageFrame(physicalAddress);
+                pageTable[ptIndex] = copyPhys | ((entry & 0xFFF) & ~PAGE_COW) | PAGE_WRITABLE;
+                handled = true;
+            }
+        } else {
+            pageTable[ptIndex] = (entry & ~PAGE_COW) | PAGE_WRITABLE;
+            handled = true;
+        }
+    }
+    kernelSpace->unMap((inwox_vir_addr_t)pageTable);
+    kthread_mutex_unlock(&temporaryMutex);
+
+    if (handled) {
+        __asm__ __volatile__("invlpg (%0)" ::"r"(address));
+    }
+    return handled;
+}
+
+/**
+ * @brief 按需分配物理内存
+ * 
+ * 找到包含该地址的段，若其为SEG_LAZY段且访问方式被允许，则分配一页物理内存，清零后映射
+ * 
+ * @param address 被访问的页，4K对齐
+ * @param write 是否为写访问
+ * @return true 已分配
+ * @return false 访问了未分配的地址、访问方式不被允许或没有可用内存
+ */
+bool AddressSpace::mapOnDemand(inwox_vir_addr_t address, bool write)
+{
+    MemorySegment *segment = MemorySegment::findSegment(segmentTree, address);
+    if (!segment || !(segment->flags & SEG_LAZY)) {
+        return false;
+    }
+    int protection = segment->flags & _PROT_FLAGS;
+    if (protection == PROT_NONE || (write && !(protection & PROT_WRITE))) {
+        return false;
+    }
+    // 页已经映射（例如在等待锁时被处理），直接返回重新执行即可
+    if (getPhysicalAddress(address)) {
+        return true;
+    }
+
+    // 匿名映射的内容必须为0
+    inwox_phy_addr_t physicalAddress = PhysicalMemory::popZeroedPageFrame();
+    if (!physicalAddress) {
+        return false;
+    }
+    return mapAt(address, physicalAddress, protection);
+}
+
+/**
+ * @brief 将一页物理内存清零
+ * 
+ * 通过专用的临时映射页访问物理内存，不需要持有temporaryMutex
+ * 
+ * @param physicalAddress 待清零的物理页
+ */
+void AddressSpace::zeroPhysicalPage(inwox_phy_addr_t physicalAddress)
+{
+    ScopedLock lock(&zeroMutex);
+    void *page = (void *)mapTemporarily(physicalAddress, PROT_READ | PROT_WRITE, TEMPORARY_MAPPING_ZERO);
+    memset(page, 0, PAGESIZE);
+    kernelSpace->unMap((inwox_vir_addr_t)page);
+}
+
 /**
  * @brief 通过虚拟地址获取映射的物理地址
  * 
@@ -270,6 +578,17 @@ AddressSpace *AddressSpace::fork()
  * @return inwox_phy_addr_t 映射的物理地址
  */
 inwox_phy_addr_t AddressSpace::getPhysicalAddress(inwox_vir_addr_t virtualAddress)
+{
+    return getPageEntry(virtualAddress) & ~0xFFF;
+}
+
+/**
+ * @brief 获取虚拟地址对应的页表项，包括物理地址和低12位的标识
+ * 
+ * @param virtualAddress 虚拟地址
+ * @return uintptr_t 页表项，页表不存在时返回0
+ */
+uintptr_t AddressSpace::getPageEntry(inwox_vir_addr_t virtualAddress)
 {
     size_t pdIndex;
     size_t ptIndex;
@@ -283,14 +602,14 @@ inwox_phy_addr_t AddressSpace::getPhysicalAddress(inwox_vir_addr_t virtualAddres
     if (this == kernelSpace) {
         pageTable = (uintptr_t *)(RECURSIVE_MAPPING + PAGESIZE * pdIndex);
     } else {
-        kthread_mutex_lock(&kernelSpace->mutex);
+        kthread_mutex_lock(&temporaryMutex);
         pageTable = (uintptr_t *)mapTemporarily(pageDirectory[pdIndex] & ~0xFFF, PROT_READ);
     }
-    inwox_phy_addr_t result = pageTable[ptIndex] & ~0xFFF;
+    uintptr_t result = pageTable[ptIndex];
 
     if (this != kernelSpace) {
         kernelSpace->unMap((inwox_vir_addr_t)pageTable);
-        kthread_mutex_unlock(&kernelSpace->mutex);
+        kthread_mutex_unlock(&temporaryMutex);
     }
     return result;
 }
@@ -359,19 +678,23 @@ inwox_vir_addr_t AddressSpace::mapAtWithFlags(size_t pdIndex, size_t ptIndex, in
 
     // 若页表还未分配，则分配一个页的作为页表，并设置到页目录中
     if (!pageDirectory[pdIndex]) {
-        inwox_phy_addr_t pageTablePhys = PhysicalMemory::popPageFrame();
+        // 注意新分配的页表需要清零，用户页表直接使用预先清零的物理页，内核页表通过递归映射清零
+        inwox_phy_addr_t pageTablePhys;
         int pdFlags = PAGE_PRESENT | PAGE_WRITABLE;
         // 对于用户空间的操作,都加上用户可用标识
         if (this != kernelSpace) {
+            pageTablePhys = PhysicalMemory::popZeroedPageFrame();
             pdFlags |= PAGE_USER;
+        } else {
+            pageTablePhys = PhysicalMemory::popPageFrame();
         }
         pageDirectory[pdIndex] = pageTablePhys | pdFlags;
         if (this != kernelSpace) {  // 对于用户地址空间，直接将申请到的物理内存映射一个虚拟地址作为页表
-            kthread_mutex_lock(&kernelSpace->mutex);
+            kthread_mutex_lock(&temporaryMutex);
             pageTable = (uintptr_t *)mapTemporarily(pageTablePhys, PROT_READ | PROT_WRITE);
+        } else {
+            memset(pageTable, 0, PAGESIZE);
         }
-        // 注意新分配的页表需要清零
-        memset(pageTable, 0, PAGESIZE);
 
         // 对于内核地址空间，需要在全部地址空间映射这个页表
         if (this == kernelSpace) {
@@ -385,7 +708,7 @@ inwox_vir_addr_t AddressSpace::mapAtWithFlags(size_t pdIndex, size_t ptIndex, in
         }
     // 对于已经存在的页表，只需找到对应的页表虚拟地址
     } else if (this != kernelSpace) {
-        kthread_mutex_lock(&kernelSpace->mutex);
+        kthread_mutex_lock(&temporaryMutex);
         pageTable = (uintptr_t *)mapTemporarily(pageDirectory[pdIndex] & ~0xFFF, PROT_READ | PROT_WRITE);
     }
 
@@ -395,7 +718,7 @@ inwox_vir_addr_t AddressSpace::mapAtWithFlags(size_t pdIndex, size_t ptIndex, in
     // 对于用户空间,每次映射完内存,将页目录和页表释放掉
     // 内核的页目录页表常驻内存最高区域
     if (this != kernelSpace) {
-        kthread_mutex_unlock(&kernelSpace->mutex);
+        kthread_mutex_unlock(&temporaryMutex);
         kernelSpace->unMap((inwox_vir_addr_t)pageTable);
     }
     inwox_vir_addr_t virtualAddress = IndexToaddress(pdIndex, ptIndex);
@@ -422,7 +745,7 @@ inwox_vir_addr_t AddressSpace::mapFromOtherAddressSpace(AddressSpace *sourceSpac
                                                         int protection)
 {
     kthread_mutex_lock(&mutex);
-    inwox_vir_addr_t destination = MemorySegment::findAndAddNewSegment(firstSegment, size, protection);
+    inwox_vir_addr_t destination = MemorySegment::findAndAddNewSegment(segmentTree, size, protection);
     kthread_mutex_unlock(&mutex);
     for (size_t i = 0; i < size; i += PAGESIZE) {
         kthread_mutex_lock(&sourceSpace->mutex);
@@ -446,13 +769,9 @@ inwox_vir_addr_t AddressSpace::mapFromOtherAddressSpace(AddressSpace *sourceSpac
 inwox_vir_addr_t AddressSpace::mapMemory(size_t size, int protection)
 {
     ScopedLock lock(&mutex);
-    inwox_vir_addr_t virtualAddress = MemorySegment::findAndAddNewSegment(firstSegment, size, protection);
-    inwox_phy_addr_t physicalAddress;
-    for (size_t i = 0; i < size; i+=PAGESIZE) {
-        physicalAddress = PhysicalMemory::popPageFrame();
-        if (!physicalAddress || !mapAt(virtualAddress + i, physicalAddress, protection)) {
-            return 0;
-        }
+    inwox_vir_addr_t virtualAddress = MemorySegment::findAndAddNewSegment(segmentTree, size, protection);
+    if (!virtualAddress || !commitMemory(virtualAddress, size, protection)) {
+        return 0;
     }
     return virtualAddress;
 }
@@ -470,17 +789,46 @@ inwox_vir_addr_t AddressSpace::mapMemory(size_t size, int protection)
 inwox_vir_addr_t AddressSpace::mapMemory(inwox_vir_addr_t virtualAddress, size_t size, int protection)
 {
     ScopedLock lock(&mutex);
-    MemorySegment::addSegment(firstSegment, virtualAddress, size, protection);
-    inwox_phy_addr_t physicalAddress;
+    MemorySegment::addSegment(segmentTree, virtualAddress, size, protection);
+    if (!commitMemory(virtualAddress, size, protection)) {
+        return 0;
+    }
+    return virtualAddress;
+}
 
-    for (size_t i = 0; i < size; i += PAGESIZE) {
-        physicalAddress = PhysicalMemory::popPageFrame();
-        if (!physicalAddress || !mapAt(virtualAddress + i, physicalAddress, protection)) {
-            return 0;
+/**
+ * @brief 为一段虚拟内存分配物理内存并映射，需持有mutex
+ * 
+ * 物理内存按批分配，每批只对物理内存管理器加锁一次
+ * 用户地址空间使用预先清零的物理页，不会看到其他进程或内核遗留的数据
+ * 
+ * @param virtualAddress 开始地址，4K对齐
+ * @param size 内存长度
+ * @param protection 内存访问权限
+ * @return true 成功
+ * @return false 内存不足
+ */
+bool AddressSpace::commitMemory(inwox_vir_addr_t virtualAddress, size_t size, int protection)
+{
+    inwox_phy_addr_t frameList[FRAME_BATCH];
+    size_t pages = ALIGN_UP(size, PAGESIZE) / PAGESIZE;
+
+    while (pages) {
+        size_t count = pages < FRAME_BATCH ? pages : FRAME_BATCH;
+        bool allocated = this == kernelSpace ? PhysicalMemory::popPageFrames(count, frameList)
+                                             : PhysicalMemory::popZeroedPageFrames(count, frameList);
+        if (!allocated) {
+            return false;
         }
+        for (size_t i = 0; i < count; i++) {
+            if (!mapAt(virtualAddress, frameList[i], protection)) {
+                return false;
+            }
+            virtualAddress += PAGESIZE;
+        }
+        pages -= count;
     }
-
-    return virtualAddress;
+    return true;
 }
 
 /**
@@ -494,7 +842,10 @@ inwox_vir_addr_t AddressSpace::mapMemory(inwox_vir_addr_t virtualAddress, size_t
 inwox_vir_addr_t AddressSpace::mapPhysical(inwox_phy_addr_t physicalAddress, size_t size, int protection)
 {
     ScopedLock lock(&mutex);
-    inwox_vir_addr_t virtualAddress = MemorySegment::findAndAddNewSegment(firstSegment, size, protection);
+    inwox_vir_addr_t virtualAddress = MemorySegment::findAndAddNewSegment(segmentTree, size, protection);
+    if (!virtualAddress) {
+        return 0;
+    }
     for (size_t i = 0; i < size; i += PAGESIZE) {
         if (!mapAt(virtualAddress + i, physicalAddress + i, protection)) {
             return 0;
@@ -504,6 +855,22 @@ inwox_vir_addr_t AddressSpace::mapPhysical(inwox_phy_addr_t physicalAddress, siz
     return virtualAddress;
 }
 
+/**
+ * @brief 预留虚拟内存
+ * 
+ * 只在段链中登记一个SEG_LAZY段，并不分配物理内存，每页在首次访问时由缺页异常分配并清零，
+ * 用于匿名映射，程序预留而从未访问的内存不会占用物理内存
+ * 
+ * @param size 待预留内存大小
+ * @param protection 内存访问权限
+ * @return inwox_vir_addr_t 预留的虚拟内存
+ */
+inwox_vir_addr_t AddressSpace::reserveMemory(size_t size, int protection)
+{
+    ScopedLock lock(&mutex);
+    return MemorySegment::findAndAddNewSegment(segmentTree, ALIGN_UP(size, PAGESIZE), protection | SEG_LAZY);
+}
+
 /**
  * @brief 取消内存页映射
  * 
@@ -528,13 +895,109 @@ void AddressSpace::unMap(inwox_vir_addr_t virtualAddress)
 void AddressSpace::unmapMemory(inwox_vir_addr_t virtualAddress, size_t size)
 {
     ScopedLock lock(&mutex);
+    releaseMemory(virtualAddress, size);
+}
+
+/**
+ * @brief 取消映射并归还物理内存，同时从段树中移除，需持有mutex
+ * 
+ * @param virtualAddress 开始地址，必须是页面的整数倍
+ * @param size 待取消映射的内存长度，不需要页对齐
+ */
+void AddressSpace::releaseMemory(inwox_vir_addr_t virtualAddress, size_t size)
+{
+    inwox_phy_addr_t frameList[FRAME_BATCH];
+    size_t frameCount = 0;
     for (size_t i = 0; i < size; i += PAGESIZE) {
         inwox_phy_addr_t physicalAddress = getPhysicalAddress(virtualAddress + i);
+        // SEG_LAZY段中从未访问的页没有物理内存
+        if (!physicalAddress) {
+            continue;
+        }
         unMap(virtualAddress + i);
-        PhysicalMemory::pushPageFrame(physicalAddress);
+        // 物理页可能因写时复制仍被其他地址空间共享，只释放本地址空间的引用
+        frameList[frameCount++] = physicalAddress;
+        if (frameCount == FRAME_BATCH) {
+            PhysicalMemory::releasePageFrames(frameCount, frameList);
+            frameCount = 0;
+        }
+    }
+    PhysicalMemory::releasePageFrames(frameCount, frameList);
+
+    MemorySegment::removeSegment(segmentTree, virtualAddress, size);
+}
+
+/**
+ * @brief 改变一段映射的大小
+ * 
+ * 缩小时释放尾部的内存；扩大时若段后的空闲空间足够则原地扩大，否则在允许移动时另找一块足够大的空间，
+ * 将原有页表项逐项移动过去，物理页本身不复制。SEG_LAZY段新增的部分在首次访问时分配，其他段立即分配
+ * 
+ * @param virtualAddress 原映射开始地址，必须是一个段的开始
+ * @param oldSize 原映射长度，必须与段长度一致（按页对齐后）
+ * @param newSize 新长度
+ * @param flags MREMAP_MAYMOVE表示允许移动到新地址
+ * @return inwox_vir_addr_t 改变大小后映射的地址，失败返回0并设置errno
+ */
+inwox_vir_addr_t AddressSpace::remapMemory(inwox_vir_addr_t virtualAddress, size_t oldSize, size_t newSize,
+                                           int flags)
+{
+    ScopedLock lock(&mutex);
+    oldSize = ALIGN_UP(oldSize, PAGESIZE);
+    newSize = ALIGN_UP(newSize, PAGESIZE);
+    MemorySegment *segment = MemorySegment::findSegment(segmentTree, virtualAddress);
+    if (!segment || segment->address != virtualAddress || segment->size != oldSize ||
+        (segment->flags & SEG_NOUNMAP)) {
+        errno = EINVAL;
+        return 0;
+    }
+    int segmentFlags = segment->flags;
+    int protection = segmentFlags & _PROT_FLAGS;
+
+    if (newSize <= oldSize) {
+        if (newSize < oldSize) {
+            releaseMemory(virtualAddress + newSize, oldSize - newSize);
+        }
+        return virtualAddress;
+    }
+
+    if (MemorySegment::extendSegment(segment, newSize)) {
+        if (!(segmentFlags & SEG_LAZY) && !commitMemory(virtualAddress + oldSize, newSize - oldSize, protection)) {
+            releaseMemory(virtualAddress + oldSize, newSize - oldSize);
+            errno = ENOMEM;
+            return 0;
+        }
+        return virtualAddress;
     }
 
-    MemorySegment::removeSegment(firstSegment, virtualAddress, size);
+    if (!(flags & MREMAP_MAYMOVE)) {
+        errno = ENOMEM;
+        return 0;
+    }
+    inwox_vir_addr_t newAddress = MemorySegment::findAndAddNewSegment(segmentTree, newSize, segmentFlags);
+    if (!newAddress) {
+        errno = ENOMEM;
+        return 0;
+    }
+    // 先分配新增部分的物理内存，失败时原映射保持不变
+    if (!(segmentFlags & SEG_LAZY) && !commitMemory(newAddress + oldSize, newSize - oldSize, protection)) {
+        releaseMemory(newAddress, newSize);
+        errno = ENOMEM;
+        return 0;
+    }
+    // 移动页表项，保留写时复制等标识，物理页的引用计数不变
+    for (size_t i = 0; i < oldSize; i += PAGESIZE) {
+        uintptr_t entry = getPageEntry(virtualAddress + i);
+        if (!(entry & PAGE_PRESENT)) {
+            continue;
+        }
+        size_t pdIndex, ptIndex;
+        addressToIndex(newAddress + i, pdIndex, ptIndex);
+        mapAtWithFlags(pdIndex, ptIndex, entry & ~0xFFF, entry & 0xFFF);
+        unMap(virtualAddress + i);
+    }
+    MemorySegment::removeSegment(segmentTree, virtualAddress, oldSize);
+    return newAddress;
 }
 
 /**
@@ -552,7 +1015,7 @@ void AddressSpace::unmapPhysical(inwox_vir_addr_t virtualAddress, size_t size)
         unMap(virtualAddress + i);
     }
 
-    MemorySegment::removeSegment(firstSegment, virtualAddress, size);
+    MemorySegment::removeSegment(segmentTree, virtualAddress, size);
 }
 
 /**
@@ -580,3 +1043,16 @@ extern "C" void __unmapMemory(void *addr, size_t size)
 {
     kernelSpace->unmapMemory((inwox_vir_addr_t)addr, size);
 }
+
+/**
+ * @brief 改变内存映射的大小，用于libk
+ * 
+ * @param addr 原映射的虚拟地址
+ * @param oldSize 原映射的大小
+ * @param newSize 新的大小
+ * @return void* 新映射的虚拟地址，失败返回nullptr
+ */
+extern "C" void *__remapMemory(void *addr, size_t oldSize, size_t newSize)
+{
+    return (void *)kernelSpace->remapMemory((inwox_vir_addr_t)addr, oldSize, newSize, MREMAP_MAYMOVE);
+}
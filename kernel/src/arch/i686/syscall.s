@@ -59,3 +59,63 @@ syscallHandler:
     iret                    /* 返回用户态 */
 
 .size syscallHandler, . - syscallHandler
+
+/**
+ * sysenter进入时cs、ss为内核段，esp为MSR中的临时栈，中断已关闭，
+ * 用户程序在%ebp中给出用户栈，栈顶是返回地址，系统调用参数和int 0x49相同
+ * 返回时sysexit从%edx取eip、从%ecx取esp，因此错误码改用%ebp传递
+ * %ebp由用户程序任意给出，读取返回地址前必须确认4个字节都在0xC0000000以下，否则返回EFAULT
+ */
+.global sysenterHandler
+.type sysenterHandler, @function
+sysenterHandler:
+    mov %ss:tss+4, %esp     /* 换到当前进程的内核栈，即tss.esp0 */
+    cmp $0xBFFFFFFC, %ebp   /* 用户栈不能指向内核空间 */
+    ja sysenterFault
+    pushl (%ebp)            /* 用户返回地址 */
+    push %ebp               /* 用户栈 */
+    sti
+
+    push %edi               /* 处理系统调用参数 */
+    push %esi
+    push %edx
+    push %ecx
+    push %ebx
+
+    push %eax               /* 系统调用号 */
+
+    mov $0x10, %cx          /* 进入内核态执行 */
+    mov %cx, %ds
+    mov %cx, %es
+
+    call getSyscallHandler
+
+    add $4, %esp
+    movl $0, errno
+    call *%eax
+
+    add $20, %esp           /* 跳过参数 */
+    mov errno, %ebp         /* 系统调用时设置错误码 */
+    pop %ecx                /* 用户栈，跳过返回地址 */
+    add $4, %ecx
+    pop %edx                /* 用户返回地址 */
+
+    mov $0x23, %bx          /* 切换回用户段 */
+    mov %bx, %ds
+    mov %bx, %es
+
+    sysexit                 /* 返回用户态，中断保持开启 */
+
+/**
+ * 用户栈无效时不执行系统调用，像int 0x49出错一样返回-1并设置错误码，
+ * 无法从用户栈取得返回地址，返回到不可访问的0地址，用户程序在用户态触发异常，内核内存不会被读取
+ */
+sysenterFault:
+    mov $-1, %eax
+    mov %ebp, %ecx          /* sysexit后的esp */
+    mov $21, %ebp           /* EFAULT */
+    xor %edx, %edx
+    sti
+    sysexit
+
+.size sysenterHandler, . - sysenterHandler
@@ -29,6 +29,7 @@
 #include <string.h>
 #include <inwox/dirent.h>
 #include <inwox/kernel/directory.h>
+#include <inwox/kernel/kmemcache.h>
 #include <inwox/stat.h>
 
 DirectoryVnode::DirectoryVnode(DirectoryVnode *parentVnode, mode_t mode, dev_t dev, ino_t ino) : Vnode(S_IFDIR | mode, dev, ino)
@@ -46,6 +47,21 @@ DirectoryVnode::~DirectoryVnode()
     delete fileNames;
 }
 
+/**
+ * 目录vnode从专用的对象缓存分配，子节点数组仍使用malloc
+ */
+static KmemCache directoryVnodeCache("directoryvnode", sizeof(DirectoryVnode));
+
+void *DirectoryVnode::operator new(size_t /* size */)
+{
+    return directoryVnodeCache.allocate();
+}
+
+void DirectoryVnode::operator delete(void *object)
+{
+    directoryVnodeCache.free(object);
+}
+
 void DirectoryVnode::addChildNode(const char *path, Vnode *vnode)
 {
     ScopedLock lock(&mutex);
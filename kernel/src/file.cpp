@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <inwox/kernel/file.h>
+#include <inwox/kernel/kmemcache.h>
 #include <inwox/stat.h>
 
 FileVnode::FileVnode(const void *data, size_t size, mode_t mode, dev_t dev, ino_t ino) : Vnode(S_IFREG | mode, dev, ino)
@@ -44,6 +45,21 @@ FileVnode::~FileVnode()
     delete data;
 }
 
+/**
+ * 文件vnode从专用的对象缓存分配，文件内容仍使用malloc
+ */
+static KmemCache fileVnodeCache("filevnode", sizeof(FileVnode));
+
+void *FileVnode::operator new(size_t /* size */)
+{
+    return fileVnodeCache.allocate();
+}
+
+void FileVnode::operator delete(void *object)
+{
+    fileVnodeCache.free(object);
+}
+
 int FileVnode::ftruncate(off_t length)
 {
     if (length < 0 || length > __SIZE_MAX__) {
@@ -33,6 +33,7 @@
 #include <inwox/kernel/directory.h>
 #include <inwox/kernel/file.h>
 #include <inwox/kernel/filedescription.h>
+#include <inwox/kernel/kmemcache.h>
 
 FileDescription::FileDescription(Vnode *vnode)
 {
@@ -40,6 +41,21 @@ FileDescription::FileDescription(Vnode *vnode)
     offset = 0;
 }
 
+/**
+ * open、dup及fork复制文件描述符时创建，从专用的对象缓存分配
+ */
+static KmemCache fileDescriptionCache("filedescription", sizeof(FileDescription));
+
+void *FileDescription::operator new(size_t /* size */)
+{
+    return fileDescriptionCache.allocate();
+}
+
+void FileDescription::operator delete(void *object)
+{
+    fileDescriptionCache.free(object);
+}
+
 FileDescription *FileDescription::openat(const char *path, int flags, mode_t mode)
 {
     Vnode *node = resolvePath(vnode, path);
@@ -34,6 +34,43 @@
 #include <inwox/kernel/process.h> /* Process::schedule(r) */
 #include <inwox/kernel/terminal.h>
 
+#define CPUID_SEP        (1 << 11)
+#define MSR_SYSENTER_CS  0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+/**
+ * sysenter进入内核时使用的栈，sysenterHandler第一条指令就会换到当前进程的内核栈，
+ * 这里只是为了让MSR中的esp有合法的值
+ */
+static char sysenterStack[64] ALIGNED(16);
+
+static inline void writeMsr(uint32_t msr, uint64_t value)
+{
+    __asm__ __volatile__("wrmsr" ::"c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+/**
+ * CPU支持sysenter/sysexit时设置相应MSR，用户程序检测到相同的CPUID后改用sysenter进行系统调用，
+ * 省去中断门的权限检查和iret。sysexit返回的用户代码段和栈段为SYSENTER_CS+16和SYSENTER_CS+24，
+ * 正好是GDT中的用户代码段和用户数据段。int 0x49仍然可用
+ */
+static void sysenterInstall()
+{
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    uint32_t family = (eax >> 8) & 0xF;
+    uint32_t model = (eax >> 4) & 0xF;
+    uint32_t stepping = eax & 0xF;
+    /* 早期的Pentium Pro报告了SEP但并不支持 */
+    if (!(edx & CPUID_SEP) || (family == 6 && model < 3 && stepping < 3)) {
+        return;
+    }
+    writeMsr(MSR_SYSENTER_CS, 0x08);
+    writeMsr(MSR_SYSENTER_ESP, (uintptr_t)sysenterStack + sizeof(sysenterStack));
+    writeMsr(MSR_SYSENTER_EIP, (uintptr_t)sysenterHandler);
+}
+
 /**
  * 挨个设置IDT中的ISR，下列的isr_*只是占位符，无实际逻辑，内部都是通过调用interrupt_handler实现
  */
@@ -93,6 +130,7 @@ void irqsInstall()
     idtSetGate(48, (unsigned)isr_48, 0x08, IDT_INTERRUPT_GATE | IDT_RING0 | IDT_PRESENT);
     idtSetGate(49, (unsigned)isr_49, 0x08, IDT_INTERRUPT_GATE | IDT_RING3 | IDT_PRESENT);
     idtSetGate(73, (unsigned)syscallHandler, 0x08, IDT_TRAP_GATE | IDT_RING3 | IDT_PRESENT);
+    sysenterInstall();
 }
 
 /**
@@ -132,11 +170,24 @@ void Interrupt::initPic()
 extern "C" struct context *interruptHandler(struct context *r)
 {
     struct context *newContext = r;
+    if (r->int_no == 14) {
+        /* 缺页异常，%cr2中为引发异常的地址，先交给当前地址空间处理（如写时复制） */
+        inwox_vir_addr_t address;
+        __asm__ __volatile__("mov %%cr2, %0" : "=r"(address));
+        if (Process::current && Process::current->addressSpace->handlePageFault(address, r->err_code)) {
+            return newContext;
+        }
+    }
     if (r->int_no < 32) {
         terminal.warnTerminal();
         Print::printf("eax: 0x%x, ebx: 0x%x, ecx: 0x%x, edx: 0x%x\n", r->eax, r->ebx, r->ecx, r->edx);
         Print::printf("edi: 0x%x, esi: 0x%x, ebp: 0x%x, esp: 0x%x\n", r->edi, r->esi, r->ebp, r->esp);
         Print::printf("cs: 0x%x, eip: 0x%x, eflags: 0x%x, ss: 0x%x\n", r->cs, r->eip, r->eflags, r->ss);
+        if (r->int_no == 14) {
+            inwox_vir_addr_t address;
+            __asm__ __volatile__("mov %%cr2, %0" : "=r"(address));
+            Print::printf("cr2: 0x%x, error code: 0x%x\n", address, r->err_code);
+        }
         Print::printf("%s", exceptionMessages[r->int_no]);
         Print::printf(" Exception. System Halted!\n");
         while (1) {
@@ -42,6 +42,7 @@
 #include <inwox/kernel/print.h>
 #include <inwox/kernel/process.h>
 #include <inwox/kernel/terminal.h>
+#include <inwox/kernel/vdata.h>
 
 #ifndef INWOX_VERSION
 #define INWOX_VERSION ""
@@ -126,6 +127,9 @@ extern "C" void kernel_main(uint32_t magic, inwox_phy_addr_t multibootAddress)
     DirectoryVnode *rootDir = loadInitrd(&multiboot);
     FileDescription *rootFd = new FileDescription(rootDir);
 
+    Print::printf("Initializing Shared Data Page...\n");
+    VData::initialize();
+
     Print::printf("Initializing Process...\n");
     Process::initialize(rootFd);
 
@@ -148,8 +152,11 @@ extern "C" void kernel_main(uint32_t magic, inwox_phy_addr_t multibootAddress)
 
     Print::printf("Initialization completed!\n");
 
+    /* 此后kernel_main作为空闲进程运行，先完成后台工作（如加入推迟的高端内存、预先清零内存页），
+     * 没有工作时暂停CPU，当中断到来再开始执行 */
     while (1) {
-        /* 暂停CPU，当中断到来再开始执行 */
-        __asm__ __volatile__("hlt");
+        if (!PhysicalMemory::doBackgroundWork()) {
+            __asm__ __volatile__("hlt");
+        }
     }
 }
@@ -0,0 +1,117 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* kernel/src/kmemcache.cpp
+ * 内核对象缓存
+ */
+
+#include <inwox/kernel/addressspace.h>
+#include <inwox/kernel/kmemcache.h>
+
+/* 对象按8字节对齐 */
+#define KMEM_CACHE_ALIGN 8
+/* 一个slab至少容纳的对象个数，对象较大时slab为多页 */
+#define KMEM_CACHE_MIN_OBJECTS 8
+
+/**
+ * @brief KmemCache构造函数
+ * 
+ * 只记录对象大小，第一次分配时才申请slab
+ * 
+ * @param name 缓存名称
+ * @param objectSize 对象大小
+ */
+KmemCache::KmemCache(const char *name, size_t objectSize)
+{
+    this->name = name;
+    if (objectSize < sizeof(void *)) {
+        objectSize = sizeof(void *);
+    }
+    this->objectSize = ALIGN_UP(objectSize, KMEM_CACHE_ALIGN);
+    if (this->objectSize * KMEM_CACHE_MIN_OBJECTS <= PAGESIZE) {
+        slabSize = PAGESIZE;
+    } else {
+        slabSize = ALIGN_UP(this->objectSize * KMEM_CACHE_MIN_OBJECTS, PAGESIZE);
+    }
+    totalCount = 0;
+    freeCount = 0;
+    freeList = nullptr;
+    mutex = KTHREAD_MUTEX_INITIALIZER;
+}
+
+/**
+ * @brief 从缓存分配一个对象
+ * 
+ * @return void* 对象地址，没有可用内存时返回nullptr
+ */
+void *KmemCache::allocate()
+{
+    ScopedLock lock(&mutex);
+    if (!freeList && !grow()) {
+        return nullptr;
+    }
+    void *object = freeList;
+    freeList = *(void **)object;
+    freeCount--;
+    return object;
+}
+
+/**
+ * @brief 将对象归还缓存
+ * 
+ * @param object 对象地址，可以为nullptr
+ */
+void KmemCache::free(void *object)
+{
+    if (!object) {
+        return;
+    }
+    ScopedLock lock(&mutex);
+    *(void **)object = freeList;
+    freeList = object;
+    freeCount++;
+}
+
+/**
+ * @brief 申请一个新的slab，并将其中的对象全部放入空闲链表，需持有mutex
+ * 
+ * @return true 成功
+ * @return false 没有可用内存
+ */
+bool KmemCache::grow()
+{
+    char *slab = (char *)kernelSpace->mapMemory(slabSize, PROT_READ | PROT_WRITE);
+    if (!slab) {
+        return false;
+    }
+    size_t count = slabSize / objectSize;
+    // 倒序放入，使分配顺序与地址顺序一致
+    for (size_t i = count; i > 0; i--) {
+        void *object = slab + (i - 1) * objectSize;
+        *(void **)object = freeList;
+        freeList = object;
+    }
+    totalCount += count;
+    freeCount += count;
+    return true;
+}
@@ -61,4 +61,21 @@ extern "C" void __unlockHeap(void) {
     kthread_mutex_unlock(&heapLock);
 }
 
+/**
+ * malloc的小块缓存是每个CPU一组，只需关闭中断防止在操作缓存时被切换到其他线程，
+ * 返回之前的eflags，解锁时据此恢复中断状态
+ */
+unsigned long __lockCache(void) {
+    unsigned long eflags;
+    __asm__ __volatile__("pushf\n\tpop %0\n\tcli" : "=r"(eflags) :: "memory");
+    return eflags;
+}
+
+void __unlockCache(unsigned long state) {
+    // eflags的IF位
+    if (state & (1 << 9)) {
+        __asm__ __volatile__("sti" ::: "memory");
+    }
+}
+
 } /* extern "C" */
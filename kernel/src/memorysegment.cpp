@@ -23,35 +23,52 @@
 
 /**
  * kernel/src/memorysegment.cpp
- * 内存分段,段是一个逻辑概念，每个地址空间有一个段表（链），给地址空间分配内存时也相应的分配段，
+ * 内存分段,段是一个逻辑概念，每个地址空间有一个段表（平衡树，同时按地址连成链），给地址空间分配内存时也相应的分配段，
  * 释放内存时也一起释放，当地址空间销毁时则遍历段链，将全部内存释放。
  */
 
 #include <assert.h>
-#include <string.h>
 #include <inwox/kernel/addressspace.h>
 #include <inwox/kernel/kthread.h>
 #include <inwox/kernel/memorysegment.h>
 #include <inwox/kernel/physicalmemory.h>
 
 /**
- * 用1页的空间存放segment的索引，当前一个segment用20个字节表示，最多可以管理204个
- * 若有更多的段需要管理，可自动分配此字段的长度
+ * 段描述符的slab缓存，首页为静态的segmentsPage，当前一个segment用40个字节表示，每页可以存放102个，
+ * 不够时每次再分配1页。空闲的描述符通过其首个字连成单向链表，并记录空闲个数，分配和释放都是O(1)
  */
 static char segmentsPage[PAGESIZE] ALIGNED(PAGESIZE) = {0};
 
-static kthread_mutex_t mutex = KTHREAD_MUTEX_INITIALIZER;
+struct FreeSegment {
+    FreeSegment *next;
+};
+
+static FreeSegment *freeSegments = nullptr;
+static size_t freeSegmentCount = 0;
+static bool segmentsPageAdded = false;
+
+/**
+ * 段描述符缓存为全部地址空间共用，由cacheMutex保护；各地址空间的段树由其所属地址空间的mutex保护，
+ * 本文件中操作段树的函数都要求调用者已经持有该锁
+ * 缓存中空闲描述符不多于SEGMENT_CACHE_RESERVE个时增长，预留的描述符供并发分配及记录新页本身的段使用
+ */
+static kthread_mutex_t cacheMutex = KTHREAD_MUTEX_INITIALIZER;
+#define SEGMENT_CACHE_RESERVE 8
 
 /**
  * @brief 获取segment可用空间大小
  * 
- * 由于segment在虚拟地址中是按顺序存放，所以空闲部分可以通过上一个和下一个的首地址和长度来计算得出
+ * 由于segment在虚拟地址中是按顺序存放，所以空闲部分可以通过下一个段的首地址和本段的结束地址来计算得出，
+ * 最后一个段之后不再有可用空间
  * 
  * @param segment 要查找的segment
  * @return size_t 空闲空间大小
  */
 static inline size_t getFreeSpaceAfter(MemorySegment *segment)
 {
+    if (!segment->next) {
+        return 0;
+    }
     return segment->next->address - (segment->address + segment->size);
 }
 
@@ -59,7 +76,7 @@ static inline size_t getFreeSpaceAfter(MemorySegment *segment)
  * @brief MemorySegment构造函数
  * 
  * 内存段通过两个指针连接成一个链，一个地址空间对应一个内存段链，释放一个地址空间的全部内存
- * 可以通过遍历此链进行
+ * 可以通过遍历此链进行，树结构相关字段在加入树时设置
  * 
  * @param address 本段开始地址
  * @param size 段长度
@@ -74,146 +91,412 @@ MemorySegment::MemorySegment(inwox_vir_addr_t address, size_t size, int flags, M
     this->flags = flags;
     this->prev = prev;
     this->next = next;
+    parent = nullptr;
+    left = nullptr;
+    right = nullptr;
+    maxGap = 0;
+    height = 1;
 }
 
 /**
- * @brief 将指定地址指定长度的虚拟内存加入段链
+ * @brief 将新段加入到段树
  * 
- * @param firstSegment 段首元素
- * @param address 待加入段链的虚拟内存起始地址
+ * @param tree 段树的根
+ * @param newSegment 新段元素
+ */
+void MemorySegment::addSegment(MemorySegment *&tree, MemorySegment *newSegment)
+{
+    insertSegment(tree, newSegment);
+}
+
+/**
+ * @brief 将指定地址指定长度的虚拟内存加入段树
+ * 
+ * @param tree 段树的根
+ * @param address 待加入段树的虚拟内存起始地址
  * @param size 虚拟内存长度
  * @param protection 保护位
  */
-void MemorySegment::addSegment(MemorySegment *firstSegment, inwox_vir_addr_t address, size_t size, int protection)
+void MemorySegment::addSegment(MemorySegment *&tree, inwox_vir_addr_t address, size_t size, int protection)
 {
-    ScopedLock lock(&mutex);
     MemorySegment *newSegment = allocateSegment(address, size, protection);
-    addSegment(firstSegment, newSegment);
-    verifySegmentList();
+    insertSegment(tree, newSegment);
+    growSegmentCache(tree);
 }
 
 /**
- * @brief 从内存段链表移除指定区段虚拟内存
+ * @brief 从段树移除指定区段虚拟内存
+ * 
+ * 先在树中找到第一个与该区段重叠的段，再沿链表向后处理，完全覆盖的段被删除，部分覆盖的段被截短或拆分
  * 
- * @param firstSegment 链表首元素
+ * @param tree 段树的根
  * @param address 移除的虚拟内存首地址
  * @param size 长度
  */
-void MemorySegment::removeSegment(MemorySegment *firstSegment, inwox_vir_addr_t address, size_t size)
+void MemorySegment::removeSegment(MemorySegment *&tree, inwox_vir_addr_t address, size_t size)
 {
-    ScopedLock lock(&mutex);
-    MemorySegment *currentSegment = firstSegment;
-
-    while (currentSegment->address + currentSegment->size <= address) {
-        currentSegment = currentSegment->next;
+    // 最高处的段结束地址会回绕为0，使用64位计算结束地址
+    uint64_t end = (uint64_t)address + size;
+    MemorySegment *currentSegment = nullptr;
+    MemorySegment *node = tree;
+    while (node) {
+        if ((uint64_t)node->address + node->size > address) {
+            currentSegment = node;
+            node = node->left;
+        } else {
+            node = node->right;
+        }
     }
 
-    while (size) {
-        if (currentSegment->address == address && currentSegment->size <= size) {
-            // 将整个段移除
-            address += currentSegment->size;
-            size -= currentSegment->size;
+    while (currentSegment && currentSegment->address < end) {
+        MemorySegment *next = currentSegment->next;
+        uint64_t segmentEnd = (uint64_t)currentSegment->address + currentSegment->size;
 
-            if (size < getFreeSpaceAfter(currentSegment)) {
-                size = 0;
-            } else {
-                size -= getFreeSpaceAfter(currentSegment);
-            }
-
-            MemorySegment *next = currentSegment->next;
-            if (next) {
-                next->prev = currentSegment->prev;
-            }
+        if (currentSegment->address >= address && segmentEnd <= end) {
+            // 将整个段移除
+            eraseSegment(tree, currentSegment);
+            deallocateSegment(currentSegment);
+        } else if (currentSegment->address >= address) {
+            // 移除段的前半部分，前一个段之后的空闲空间随之变大
+            currentSegment->address = end;
+            currentSegment->size = segmentEnd - end;
+            updatePath(currentSegment);
             if (currentSegment->prev) {
-                currentSegment->prev->next = next;
+                updatePath(currentSegment->prev);
             }
-
-            deallocateSegment(currentSegment);
-            currentSegment = next;
-            continue;
-        } else if (currentSegment->address == address && currentSegment->size > size) {
-            currentSegment->address += size;
-            currentSegment->size -= size;
-            size = 0;
-        } else if (currentSegment->address + currentSegment->size < address + size) {
-            size_t diff = currentSegment->address + currentSegment->size - address;
-            currentSegment->size -= diff;
-            size -= diff;
-            address += diff;
+        } else if (segmentEnd <= end) {
+            // 移除段的后半部分
+            currentSegment->size = address - currentSegment->address;
+            updatePath(currentSegment);
         } else {
             // 拆分段
-            size_t firstSize = address - currentSegment->address;
-            size_t secondSize = currentSegment->size - firstSize - size;
-
-            MemorySegment *newSegment = allocateSegment(address + size, secondSize, currentSegment->flags);
+            MemorySegment *newSegment = allocateSegment(end, segmentEnd - end, currentSegment->flags);
+            currentSegment->size = address - currentSegment->address;
+            insertSegment(tree, newSegment);
+        }
+        currentSegment = next;
+    }
+    growSegmentCache(tree);
+}
 
-            newSegment->prev = currentSegment;
-            newSegment->next = currentSegment->next;
+/**
+ * @brief 在可用的地址空间中找到一块空闲的segment
+ * 
+ * 每个节点记录了子树中最大的空闲空间，优先在左子树（低地址）中查找，其次是本段之后，最后是右子树，
+ * 找到的是地址最低的满足条件的空闲空间
+ * 
+ * @param tree 段树的根
+ * @param size 要找的空闲segment大小
+ * @return inwox_vir_addr_t 空闲segment虚拟地址，没有足够的空闲空间时返回0
+ */
+inwox_vir_addr_t MemorySegment::findFreeSegment(MemorySegment *tree, size_t size)
+{
+    MemorySegment *currentSegment = tree;
+    if (!currentSegment || currentSegment->maxGap < size) {
+        return 0;
+    }
+    while (true) {
+        if (currentSegment->left && currentSegment->left->maxGap >= size) {
+            currentSegment = currentSegment->left;
+        } else if (getFreeSpaceAfter(currentSegment) >= size) {
+            return currentSegment->address + currentSegment->size;
+        } else {
+            currentSegment = currentSegment->right;
+        }
+    }
+}
 
-            currentSegment->next = newSegment;
-            currentSegment->size = firstSize;
+/**
+ * @brief 查找包含指定虚拟地址的段
+ * 
+ * @param tree 段树的根
+ * @param address 待查找的虚拟地址
+ * @return MemorySegment* 包含该地址的段，地址未分配时返回nullptr
+ */
+MemorySegment *MemorySegment::findSegment(MemorySegment *tree, inwox_vir_addr_t address)
+{
+    MemorySegment *currentSegment = tree;
+    while (currentSegment) {
+        if (address < currentSegment->address) {
+            currentSegment = currentSegment->left;
+        } else if (address - currentSegment->address < currentSegment->size) {
+            return currentSegment;
+        } else {
+            currentSegment = currentSegment->right;
         }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 原地扩大一个段，段之后的空闲空间不足时失败
+ * 
+ * 段的结束地址变化只影响本段之后的空闲空间，沿本段向上更新即可
+ * 
+ * @param segment 待扩大的段
+ * @param size 新的段长度，不小于原长度
+ * @return true 成功
+ * @return false 段之后的空闲空间不足
+ */
+bool MemorySegment::extendSegment(MemorySegment *segment, size_t size)
+{
+    if (size - segment->size > getFreeSpaceAfter(segment)) {
+        return false;
+    }
+    segment->size = size;
+    updatePath(segment);
+    return true;
+}
 
-        if (size < getFreeSpaceAfter(currentSegment)) {
-            size = 0;
+/**
+ * @brief 将新段插入段树并链入段链表
+ * 
+ * 新段的前一个和后一个段都是其祖先节点，沿插入路径向上更新即可维护各节点的最大空闲空间
+ * 
+ * @param tree 段树的根
+ * @param newSegment 新段元素
+ */
+void MemorySegment::insertSegment(MemorySegment *&tree, MemorySegment *newSegment)
+{
+    MemorySegment *parent = nullptr;
+    MemorySegment *prev = nullptr;
+    MemorySegment *next = nullptr;
+    MemorySegment **link = &tree;
+
+    while (*link) {
+        parent = *link;
+        if (newSegment->address < parent->address) {
+            next = parent;
+            link = &parent->left;
         } else {
-            size -= getFreeSpaceAfter(currentSegment);
+            prev = parent;
+            link = &parent->right;
         }
+    }
+
+    assert(!prev || prev->address + prev->size <= newSegment->address);
+    assert(!next || newSegment->address + newSegment->size <= next->address);
+
+    newSegment->parent = parent;
+    newSegment->left = nullptr;
+    newSegment->right = nullptr;
+    *link = newSegment;
 
-        currentSegment = currentSegment->next;
+    newSegment->prev = prev;
+    newSegment->next = next;
+    if (prev) {
+        prev->next = newSegment;
     }
-    verifySegmentList();
+    if (next) {
+        next->prev = newSegment;
+    }
+    rebalance(tree, newSegment);
 }
 
 /**
- * @brief 在可用的地址空间中找到一块空闲的segment
+ * @brief 将段从段树和段链表中删除，不释放段本身
  * 
- * @param firstSegment 第一个segment
- * @param size 要找的空闲segment大小
- * @return inwox_vir_addr_t 空闲segment虚拟地址
+ * @param tree 段树的根
+ * @param segment 待删除的段
  */
-inwox_vir_addr_t MemorySegment::findFreeSegment(MemorySegment *firstSegment, size_t size)
+void MemorySegment::eraseSegment(MemorySegment *&tree, MemorySegment *segment)
 {
-    MemorySegment *currentSegment = firstSegment;
-    while (getFreeSpaceAfter(currentSegment) < size) {
-        currentSegment = currentSegment->next;
-        if (!currentSegment) {
-            return 0;
+    MemorySegment *prev = segment->prev;
+    MemorySegment *next = segment->next;
+    if (prev) {
+        prev->next = next;
+    }
+    if (next) {
+        next->prev = prev;
+    }
+
+    MemorySegment *rebalanceFrom;
+    if (segment->left && segment->right) {
+        // 有两个子节点时，用其后继（右子树的最左节点，即next）代替它的位置
+        if (next->parent == segment) {
+            rebalanceFrom = next;
+        } else {
+            rebalanceFrom = next->parent;
+            replaceChild(tree, next->parent, next, next->right);
+            if (next->right) {
+                next->right->parent = next->parent;
+            }
+            next->right = segment->right;
+            segment->right->parent = next;
+        }
+        next->left = segment->left;
+        segment->left->parent = next;
+        replaceChild(tree, segment->parent, segment, next);
+        next->parent = segment->parent;
+    } else {
+        MemorySegment *child = segment->left ? segment->left : segment->right;
+        replaceChild(tree, segment->parent, segment, child);
+        if (child) {
+            child->parent = segment->parent;
         }
+        rebalanceFrom = segment->parent;
+    }
+
+    if (rebalanceFrom) {
+        rebalance(tree, rebalanceFrom);
+    }
+    // 前一个段之后的空闲空间变大了，而它不一定在上面的路径上
+    if (prev) {
+        updatePath(prev);
     }
-    return currentSegment->address + currentSegment->size;
 }
 
 /**
- * @brief 将新段加入到段链表
+ * @brief 将父节点指向oldChild的指针改为指向newChild，父节点为空时修改树根
  * 
- * @param firstSegment 段首元素
- * @param newSegment 新段元素
+ * @param tree 段树的根
+ * @param parent 父节点
+ * @param oldChild 原子节点
+ * @param newChild 新子节点
  */
-void MemorySegment::addSegment(MemorySegment *firstSegment, MemorySegment *newSegment)
+void MemorySegment::replaceChild(MemorySegment *&tree, MemorySegment *parent, MemorySegment *oldChild,
+                                 MemorySegment *newChild)
 {
-    inwox_vir_addr_t endAddress = newSegment->address + newSegment->size;
-    MemorySegment *currentSegment = firstSegment;
+    if (!parent) {
+        tree = newChild;
+    } else if (parent->left == oldChild) {
+        parent->left = newChild;
+    } else {
+        parent->right = newChild;
+    }
+}
 
-    while (currentSegment->next && currentSegment->next->address < endAddress) {
-        currentSegment = currentSegment->next;
+/**
+ * @brief 根据子节点重新计算节点的高度和子树中最大的空闲空间
+ * 
+ * @param segment 待更新的节点
+ */
+void MemorySegment::updateNode(MemorySegment *segment)
+{
+    int leftHeight = segment->left ? segment->left->height : 0;
+    int rightHeight = segment->right ? segment->right->height : 0;
+    segment->height = 1 + (leftHeight > rightHeight ? leftHeight : rightHeight);
+
+    size_t gap = getFreeSpaceAfter(segment);
+    if (segment->left && segment->left->maxGap > gap) {
+        gap = segment->left->maxGap;
+    }
+    if (segment->right && segment->right->maxGap > gap) {
+        gap = segment->right->maxGap;
     }
+    segment->maxGap = gap;
+}
 
-    assert(currentSegment->address + currentSegment->size <= newSegment->address);
-    assert(!currentSegment->next || currentSegment->next->address >= endAddress);
+/**
+ * @brief 从指定节点向上更新到树根，用于树结构不变而段的地址或长度改变的情况
+ * 
+ * @param segment 开始更新的节点
+ */
+void MemorySegment::updatePath(MemorySegment *segment)
+{
+    while (segment) {
+        updateNode(segment);
+        segment = segment->parent;
+    }
+}
 
-    newSegment->prev = currentSegment;
-    newSegment->next = currentSegment->next;
+/**
+ * @brief 左旋，segment的右子节点成为这棵子树的根
+ * 
+ * @param tree 段树的根
+ * @param segment 子树的根
+ * @return MemorySegment* 旋转后子树的根
+ */
+MemorySegment *MemorySegment::rotateLeft(MemorySegment *&tree, MemorySegment *segment)
+{
+    MemorySegment *child = segment->right;
+    segment->right = child->left;
+    if (child->left) {
+        child->left->parent = segment;
+    }
+    replaceChild(tree, segment->parent, segment, child);
+    child->parent = segment->parent;
+    child->left = segment;
+    segment->parent = child;
+    updateNode(segment);
+    updateNode(child);
+    return child;
+}
+
+/**
+ * @brief 右旋，segment的左子节点成为这棵子树的根
+ * 
+ * @param tree 段树的根
+ * @param segment 子树的根
+ * @return MemorySegment* 旋转后子树的根
+ */
+MemorySegment *MemorySegment::rotateRight(MemorySegment *&tree, MemorySegment *segment)
+{
+    MemorySegment *child = segment->left;
+    segment->left = child->right;
+    if (child->right) {
+        child->right->parent = segment;
+    }
+    replaceChild(tree, segment->parent, segment, child);
+    child->parent = segment->parent;
+    child->right = segment;
+    segment->parent = child;
+    updateNode(segment);
+    updateNode(child);
+    return child;
+}
+
+/**
+ * @brief 从指定节点向上到树根，更新各节点并在左右子树高度差超过1时旋转
+ * 
+ * @param tree 段树的根
+ * @param segment 开始的节点
+ */
+void MemorySegment::rebalance(MemorySegment *&tree, MemorySegment *segment)
+{
+    while (segment) {
+        updateNode(segment);
+        int leftHeight = segment->left ? segment->left->height : 0;
+        int rightHeight = segment->right ? segment->right->height : 0;
+
+        if (leftHeight > rightHeight + 1) {
+            MemorySegment *child = segment->left;
+            if ((child->left ? child->left->height : 0) < (child->right ? child->right->height : 0)) {
+                rotateLeft(tree, child);
+            }
+            segment = rotateRight(tree, segment);
+        } else if (rightHeight > leftHeight + 1) {
+            MemorySegment *child = segment->right;
+            if ((child->right ? child->right->height : 0) < (child->left ? child->left->height : 0)) {
+                rotateRight(tree, child);
+            }
+            segment = rotateLeft(tree, segment);
+        }
+        segment = segment->parent;
+    }
+}
 
-    currentSegment->next = newSegment;
-    if (newSegment->next) {
-        newSegment->next->prev = newSegment;
+/**
+ * @brief 将一页内存划分为段描述符，全部放入空闲链表
+ * 
+ * @param page 页首地址，4K对齐
+ */
+static void addSegmentsPage(void *page)
+{
+    MemorySegment *segments = (MemorySegment *)page;
+    for (size_t i = 0; i < PAGESIZE / sizeof(MemorySegment); i++) {
+        FreeSegment *freeSegment = (FreeSegment *)&segments[i];
+        freeSegment->next = freeSegments;
+        freeSegments = freeSegment;
+        freeSegmentCount++;
     }
 }
 
 /**
  * @brief 将指定位置大小的虚拟地址分配为一个段
  * 
+ * 从空闲链表头取出一个描述符，调用者必须保证缓存中还有空闲描述符（见growSegmentCache）
+ * 
  * @param address 虚拟地址
  * @param size 地址空间长度
  * @param flags 保护位
@@ -221,18 +504,15 @@ void MemorySegment::addSegment(MemorySegment *firstSegment, MemorySegment *newSe
  */
 MemorySegment *MemorySegment::allocateSegment(inwox_vir_addr_t address, size_t size, int flags)
 {
-    MemorySegment *current = (MemorySegment *)segmentsPage;
-
-    // 找到一个还未使用的segment
-    while (current->address != 0 && current->size != 0) {
-        current++;
-        // current到了segmentsPage的最后一个索引表示的segment，则去新的1K中分配可用segment
-        if (((uintptr_t)current & 0xFFF) == (PAGESIZE - PAGESIZE % sizeof(MemorySegment))) {
-            MemorySegment **nextPage = (MemorySegment **)current;
-            assert(*nextPage != nullptr);
-            current = *nextPage;
-        }
+    ScopedLock lock(&cacheMutex);
+    if (unlikely(!segmentsPageAdded)) {
+        addSegmentsPage(segmentsPage);
+        segmentsPageAdded = true;
     }
+    assert(freeSegments);
+    MemorySegment *current = (MemorySegment *)freeSegments;
+    freeSegments = freeSegments->next;
+    freeSegmentCount--;
 
     current->address = address;
     current->size = size;
@@ -242,70 +522,73 @@ MemorySegment *MemorySegment::allocateSegment(inwox_vir_addr_t address, size_t s
 }
 
 /**
- * @brief 将指定的段解除分配
+ * @brief 将指定的段解除分配，放回空闲链表
  * 
  * @param segment 待操作的段
  */
 void MemorySegment::deallocateSegment(MemorySegment *segment)
 {
-    memset(segment, 0, sizeof(MemorySegment));
+    ScopedLock lock(&cacheMutex);
+    FreeSegment *freeSegment = (FreeSegment *)segment;
+    freeSegment->next = freeSegments;
+    freeSegments = freeSegment;
+    freeSegmentCount++;
 }
 
 /**
  * @brief 在可用的地址空间中找到一块空闲的segment，并将其加入到段链表
  * 
- * @param firstSegment 锻炼表首元素
+ * @param tree 段树的根
  * @param size 空闲segment大小
  * @param protection 保护模式
- * @return inwox_vir_addr_t segment对应的虚拟地址
+ * @return inwox_vir_addr_t segment对应的虚拟地址，没有足够的空闲空间时返回0
  */
-inwox_vir_addr_t MemorySegment::findAndAddNewSegment(MemorySegment *firstSegment, size_t size, int protection)
+inwox_vir_addr_t MemorySegment::findAndAddNewSegment(MemorySegment *&tree, size_t size, int protection)
 {
-    ScopedLock lock(&mutex);
-    inwox_vir_addr_t address = findFreeSegment(firstSegment, size);
+    inwox_vir_addr_t address = findFreeSegment(tree, size);
+    if (!address) {
+        return 0;
+    }
     MemorySegment* newSegment = allocateSegment(address, size, protection);
-    addSegment(firstSegment, newSegment);
-    verifySegmentList();
+    insertSegment(tree, newSegment);
+    growSegmentCache(tree);
     return address;
 }
 
 /**
- * @brief 校验段链表是否还有剩余空间，空间不足自动分配，在addsegment处调用
+ * @brief 检查段描述符缓存是否只剩预留的空闲描述符，是则再分配1页，在分配段之后调用
+ * 
+ * 新页需要记录在内核段树中，所以要持有kernelSpace->mutex，若调用者操作的就是内核段树则已经持有。
+ * 加锁顺序为用户地址空间的mutex、kernelSpace->mutex、cacheMutex，所以检查之后先释放cacheMutex
  * 
+ * @param tree 调用者刚刚操作过的段树
  */
-void MemorySegment::verifySegmentList()
+void MemorySegment::growSegmentCache(MemorySegment *&tree)
 {
-    MemorySegment *current = (MemorySegment *)segmentsPage;
-    MemorySegment **nextPage;
+    kthread_mutex_lock(&cacheMutex);
+    bool needGrow = freeSegmentCount <= SEGMENT_CACHE_RESERVE;
+    kthread_mutex_unlock(&cacheMutex);
+    if (!needGrow) {
+        return;
+    }
 
-    // segmentsPage中，空闲条目个数
-    int freeSegmentSpaceFound = 0;
-    MemorySegment *freeSegment = nullptr;
-    while (true) {
-        if (current->address == 0 && current->size == 0) {
-            freeSegment = current;
-            freeSegmentSpaceFound++;
-        }
-        current++;
-        // current到了segmentsPage的最后一个索引表示的segment
-        if (((uintptr_t)current & 0xFFF) == (PAGESIZE - PAGESIZE % sizeof(MemorySegment))) {
-            nextPage = (MemorySegment **)current;
-            if (!*nextPage) {
-                break;
-            }
-            current = *nextPage;
+    bool kernelLocked = &tree == &kernelSpace->segmentTree;
+    if (!kernelLocked) {
+        kthread_mutex_lock(&kernelSpace->mutex);
+    }
+    inwox_vir_addr_t address = findFreeSegment(kernelSpace->segmentTree, PAGESIZE);
+    inwox_phy_addr_t physical = address ? PhysicalMemory::popPageFrame() : 0;
+    if (physical) {
+        if (kernelSpace->mapAt(address, physical, PROT_READ | PROT_WRITE)) {
+            MemorySegment *segment = allocateSegment(address, PAGESIZE, PROT_READ | PROT_WRITE);
+            insertSegment(kernelSpace->segmentTree, segment);
+            ScopedLock lock(&cacheMutex);
+            addSegmentsPage((void *)address);
+        } else {
+            PhysicalMemory::pushPageFrame(physical);
         }
     }
-    // 当用完segmentsPage的空间后，再分配1页空间，最后一个元素指向新分配的空间
-    if (freeSegmentSpaceFound == 1) {
-        inwox_vir_addr_t address = findFreeSegment(kernelSpace->firstSegment, PAGESIZE);
-        inwox_phy_addr_t physical = PhysicalMemory::popPageFrame();
-        kernelSpace->mapAt(address, physical, PROT_READ | PROT_WRITE);
-        *nextPage = (MemorySegment *)address;
-        memset(*nextPage, 0, PAGESIZE);
-        freeSegment->address = address;
-        freeSegment->size = PAGESIZE;
-        freeSegment->flags = PROT_READ | PROT_WRITE;
-        addSegment(kernelSpace->firstSegment, freeSegment);
+    if (!kernelLocked) {
+        kthread_mutex_unlock(&kernelSpace->mutex);
     }
 }
@@ -23,12 +23,15 @@
 
 /**
  * kernel/src/physicalmemory.cpp
- * 实现物理内存基本操作，主要分为两部分
+ * 实现物理内存基本操作，主要分为三部分
  * 1. 从multiboot中获取内存信息
- * 2. 使用栈来管理可用内存
- * 在栈中的内存表示可用，可以分配给调用者，使用完毕后，再push回栈中
+ * 2. 使用buddy分配器管理全部可用内存，可以分配物理连续的内存块，并在释放时合并
+ * 3. 使用栈缓存单个内存页，作为分配单页内存的快速路径，栈空时从buddy批量补充，过多时批量归还
+ * 在栈或buddy中的内存表示可用，可以分配给调用者，使用完毕后，再归还
  */
 
+#include <assert.h>
+#include <string.h>
 #include <inwox/kernel/addressspace.h>
 #include <inwox/kernel/kthread.h>
 #include <inwox/kernel/physicalmemory.h>
@@ -48,61 +51,347 @@ static size_t stackLeft = 0;
 static kthread_mutex_t mutex = KTHREAD_MUTEX_INITIALIZER;
 
 /**
- * @brief 判断某物理地址是否被内核使用
+ * 每个物理页对应一个PageFrame，以物理页号为下标
+ * next/prev  buddy空闲链表，用页号表示，只对空闲块的首页有效
+ * references 额外引用计数，写时复制的fork会让多个地址空间共享同一物理页，计数为0表示该页只有一个使用者，
+ *            释放时直接归还，否则只减少计数
+ * order      空闲块的阶数，只对空闲块的首页有效
+ * flags      FRAME_FREE表示该页为buddy中空闲块的首页
+ */
+struct PageFrame {
+    uint32_t next;
+    uint32_t prev;
+    uint16_t references;
+    uint8_t order;
+    uint8_t flags;
+};
+
+#define FRAME_FREE (1 << 0)
+/* 空闲链表结束标识 */
+#define FRAME_NONE 0xFFFFFFFF
+
+static PageFrame *frames = nullptr;
+/* frames覆盖的物理页数目 */
+static size_t frameCount = 0;
+
+/* buddy中每阶的空闲链表表头 */
+static uint32_t freeLists[BUDDY_MAX_ORDER + 1];
+/* buddy中空闲页数目 */
+static size_t buddyFreeFrames = 0;
+
+/**
+ * 栈中缓存的页数超过STACK_CACHE_HIGH时，归还buddy直到只剩STACK_CACHE_LOW页
+ * 栈为空时，从buddy一次取2^STACK_REFILL_ORDER页
+ */
+#define STACK_CACHE_HIGH   64
+#define STACK_CACHE_LOW    32
+#define STACK_REFILL_ORDER 4
+
+/**
+ * 预先清零的物理页，由空闲进程在后台补充，当少于ZERO_POOL_LOW页时开始补充，直到ZERO_POOL_SIZE页
+ * 需要清零内存的调用者（用户页表、exec、mmap等）从这里取，避免在关键路径上清零
+ */
+#define ZERO_POOL_SIZE 64
+#define ZERO_POOL_LOW  32
+static inwox_phy_addr_t zeroedFrames[ZERO_POOL_SIZE];
+static size_t zeroedCount = 0;
+
+/**
+ * 物理内存区间[start, end)，按页对齐，end可能为4G，所以使用64位
+ */
+struct PhysicalRange {
+    uint64_t start;
+    uint64_t end;
+};
+
+#define MAX_RESERVED_RANGES 32
+#define MAX_FREE_RANGES     32
+
+/**
+ * 启动时只将EARLY_MEMORY_LIMIT以下的内存交给buddy，以上的部分推迟到shell启动后，
+ * 由空闲进程在后台每次加入DEFERRED_CHUNK_SIZE，分配内存时若buddy已空也会立即加入
+ */
+#define EARLY_MEMORY_LIMIT  0x4000000
+#define DEFERRED_CHUNK_SIZE 0x1000000
+
+static PhysicalRange deferredRanges[MAX_FREE_RANGES];
+static size_t deferredRangeCount = 0;
+/* 推迟加入的页数 */
+static size_t deferredFrames = 0;
+
+/**
+ * @brief 加入一个不可用的内存区间，区间数组按开始地址排序
  * 
- * @param physicalAddress 待判断的物理地址
- * @return true 被内核使用
- * @return false 没有被内核使用
+ * @param ranges 不可用区间数组
+ * @param count 数组中的区间数目
+ * @param start 开始地址，向下按页对齐
+ * @param end 结束地址，向上按页对齐
  */
-static inline bool isUsedByKernel(inwox_phy_addr_t physicalAddress)
+static void addReservedRange(PhysicalRange *ranges, size_t &count, uint64_t start, uint64_t end)
 {
-    return (physicalAddress >= (inwox_phy_addr_t)&bootstrapBegin &&
-            physicalAddress < (inwox_phy_addr_t)&bootstrapEnd) ||
-           (physicalAddress >= (inwox_phy_addr_t)&kernelPhysicalBegin &&
-            physicalAddress < (inwox_phy_addr_t)&kernelPhysicalEnd) ||
-           physicalAddress == 0;
+    assert(count < MAX_RESERVED_RANGES);
+    start &= ~0xFFF;
+    end = ALIGN_UP(end, PAGESIZE);
+    size_t i = count++;
+    while (i > 0 && ranges[i - 1].start > start) {
+        ranges[i] = ranges[i - 1];
+        i--;
+    }
+    ranges[i].start = start;
+    ranges[i].end = end;
 }
 
 /**
- * @brief 判断某物理地址是否被multiboot module使用
+ * @brief 从可用内存区间中减去全部不可用区间，将剩余部分加入空闲区间数组
  * 
- * @param physicalAddress 待判断的物理地址
- * @param modules 
- * @param moduleCount 
- * @return true 
- * @return false 
+ * 不可用区间已按开始地址排序，只需顺序扫描一遍
+ * 
+ * @param reserved 不可用区间数组
+ * @param reservedCount 不可用区间数目
+ * @param start 可用区间开始地址
+ * @param end 可用区间结束地址
+ * @param freeRanges 空闲区间数组
+ * @param freeCount 空闲区间数目
  */
-static inline bool isUsedByModule(inwox_phy_addr_t physicalAddress, multiboot_mod_list *modules, uint32_t moduleCount)
+static void subtractReservedRanges(const PhysicalRange *reserved, size_t reservedCount, uint64_t start, uint64_t end,
+                                   PhysicalRange *freeRanges, size_t &freeCount)
 {
-    for (size_t i = 0; i < moduleCount; i++) {
-        if (physicalAddress >= modules[i].mod_start && physicalAddress < modules[i].mod_end) {
-            return true;
+    for (size_t i = 0; i < reservedCount && start < end; i++) {
+        if (reserved[i].end <= start) {
+            continue;
+        }
+        if (reserved[i].start >= end) {
+            break;
         }
+        if (reserved[i].start > start && freeCount < MAX_FREE_RANGES) {
+            freeRanges[freeCount].start = start;
+            freeRanges[freeCount++].end = reserved[i].start;
+        }
+        start = reserved[i].end;
+    }
+    if (start < end && freeCount < MAX_FREE_RANGES) {
+        freeRanges[freeCount].start = start;
+        freeRanges[freeCount++].end = end;
     }
-    return false;
 }
 
 /**
- * @brief 判断某物理地址是否被multiboot使用
+ * @brief 将空闲块加入对应阶的空闲链表，不进行合并
  * 
- * @param physicalAddress 
- * @param multiboot 
- * @return true 
- * @return false 
+ * @param frame 块的首页页号
+ * @param order 块的阶数
+ */
+static void buddyInsert(size_t frame, unsigned int order)
+{
+    frames[frame].flags |= FRAME_FREE;
+    frames[frame].order = order;
+    frames[frame].prev = FRAME_NONE;
+    frames[frame].next = freeLists[order];
+    if (freeLists[order] != FRAME_NONE) {
+        frames[freeLists[order]].prev = frame;
+    }
+    freeLists[order] = frame;
+    buddyFreeFrames += 1 << order;
+}
+
+/**
+ * @brief 将空闲块从对应阶的空闲链表中移除
+ * 
+ * @param frame 块的首页页号
+ * @param order 块的阶数
+ */
+static void buddyRemove(size_t frame, unsigned int order)
+{
+    if (frames[frame].prev != FRAME_NONE) {
+        frames[frames[frame].prev].next = frames[frame].next;
+    } else {
+        freeLists[order] = frames[frame].next;
+    }
+    if (frames[frame].next != FRAME_NONE) {
+        frames[frames[frame].next].prev = frames[frame].prev;
+    }
+    frames[frame].flags &= ~FRAME_FREE;
+    buddyFreeFrames -= 1 << order;
+}
+
+/**
+ * @brief 从buddy中分配一个指定阶数的块
+ * 
+ * 从该阶开始向上找到第一个非空的空闲链表，取出其中的块，多余的部分逐级对半拆分后放回低阶链表
+ * 
+ * @param order 块的阶数
+ * @return size_t 块的首页页号，没有足够大的块时返回FRAME_NONE
+ */
+static size_t buddyAllocate(unsigned int order)
+{
+    unsigned int current = order;
+    while (current <= BUDDY_MAX_ORDER && freeLists[current] == FRAME_NONE) {
+        current++;
+    }
+    if (current > BUDDY_MAX_ORDER) {
+        return FRAME_NONE;
+    }
+    size_t frame = freeLists[current];
+    buddyRemove(frame, current);
+    while (current > order) {
+        current--;
+        buddyInsert(frame + (1 << current), current);
+    }
+    return frame;
+}
+
+/**
+ * @brief 将块归还buddy
+ * 
+ * 若与其伙伴块（地址只在第order位不同的同阶块）都空闲，则合并为高一阶的块，直到不能合并为止
+ * 
+ * @param frame 块的首页页号
+ * @param order 块的阶数
+ */
+static void buddyFree(size_t frame, unsigned int order)
+{
+    while (order < BUDDY_MAX_ORDER) {
+        size_t buddy = frame ^ (1 << order);
+        if (buddy >= frameCount || !(frames[buddy].flags & FRAME_FREE) || frames[buddy].order != order) {
+            break;
+        }
+        buddyRemove(buddy, order);
+        frame &= ~(1 << order);
+        order++;
+    }
+    buddyInsert(frame, order);
+}
+
+/**
+ * @brief 将一段连续的物理内存整体加入buddy，需持有mutex
+ * 
+ * 区间被拆分为尽可能大的对齐块，每块只需插入一次
+ * 
+ * @param start 开始地址，4K对齐
+ * @param end 结束地址，4K对齐
  */
-static inline bool isUsedByMultiboot(inwox_phy_addr_t physicalAddress, multiboot_info *multiboot)
+static void buddyAddRange(uint64_t start, uint64_t end)
 {
-    inwox_phy_addr_t mmapEnd = multiboot->mmap_addr + multiboot->mmap_length;
-    inwox_phy_addr_t modsEnd = multiboot->mods_addr + multiboot->mods_count * sizeof(multiboot_mod_list);
-    return ((physicalAddress >= (multiboot->mmap_addr & ~0xFFF) && physicalAddress < mmapEnd) ||
-            (physicalAddress >= (multiboot->mods_addr & ~0xFFF) && physicalAddress < modsEnd));
+    size_t frame = start / PAGESIZE;
+    size_t lastFrame = end / PAGESIZE;
+    while (frame < lastFrame) {
+        unsigned int order = 0;
+        while (order < BUDDY_MAX_ORDER && !(frame & (1u << order)) && frame + (2u << order) <= lastFrame) {
+            order++;
+        }
+        buddyFree(frame, order);
+        frame += 1u << order;
+    }
+}
+
+/**
+ * @brief 将推迟的内存加入buddy，每次最多DEFERRED_CHUNK_SIZE，需持有mutex
+ * 
+ * @return true 加入了内存
+ * @return false 没有推迟的内存
+ */
+static bool addDeferredChunk()
+{
+    if (!deferredRangeCount) {
+        return false;
+    }
+    PhysicalRange *range = &deferredRanges[deferredRangeCount - 1];
+    uint64_t end = range->end;
+    if (end - range->start > DEFERRED_CHUNK_SIZE) {
+        end = range->start + DEFERRED_CHUNK_SIZE;
+    }
+    buddyAddRange(range->start, end);
+    deferredFrames -= (end - range->start) / PAGESIZE;
+    range->start = end;
+    if (range->start == range->end) {
+        deferredRangeCount--;
+    }
+    return true;
+}
+
+/**
+ * @brief 将物理页压入栈中，需持有mutex
+ * 
+ * 当管理栈还有空间时，直接将物理内存压栈，若栈空间用完，则将此页作为物理内存管理栈的一部分
+ * 合并入栈的虚拟地址空间
+ * 
+ * @param physicalAddress 物理页
+ */
+static void stackPush(inwox_phy_addr_t physicalAddress)
+{
+    if (unlikely(stackLeft == 0)) {
+        kernelSpace->mapAt((inwox_vir_addr_t)stack - stackUsed * 4 - PAGESIZE, physicalAddress,
+                                 PROT_READ | PROT_WRITE);
+        stackLeft += 1024;
+    } else {
+        stack[-++stackUsed] = physicalAddress;
+        stackLeft--;
+    }
+}
+
+/**
+ * @brief 从栈中弹出物理页，需持有mutex
+ * 
+ * 栈中没有缓存的页时，将栈本身占用的页取消映射后返回
+ * 
+ * @return inwox_phy_addr_t 物理页，栈中没有任何页时返回0
+ */
+static inwox_phy_addr_t stackPop()
+{
+    if (unlikely(stackUsed == 0)) {
+        if (likely(stackLeft > 0)) {
+            inwox_vir_addr_t virtualAddress = (inwox_vir_addr_t)stack - stackLeft * 4;
+            inwox_phy_addr_t result = kernelSpace->getPhysicalAddress(virtualAddress);
+            kernelSpace->unMap(virtualAddress);
+            stackLeft -= 1024;
+            return result;
+        }
+        return 0;
+    }
+    stackLeft++;
+    return stack[-stackUsed--];
+}
+
+/**
+ * @brief 栈为空时，从buddy取一块内存放入栈中，需持有mutex
+ * 
+ * buddy中没有内存时，先加入推迟的内存再取
+ */
+static void refillStack()
+{
+    do {
+        for (int order = STACK_REFILL_ORDER; order >= 0; order--) {
+            size_t frame = buddyAllocate(order);
+            if (frame != FRAME_NONE) {
+                for (size_t i = 0; i < (1u << order); i++) {
+                    stackPush((frame + i) * PAGESIZE);
+                }
+                return;
+            }
+        }
+    } while (addDeferredChunk());
+}
+
+/**
+ * @brief 将栈中缓存的页归还buddy，直到只剩count页，需持有mutex
+ * 
+ * @param count 栈中保留的页数
+ */
+static void drainStack(size_t count)
+{
+    while (stackUsed > count) {
+        buddyFree(stackPop() / PAGESIZE, 0);
+    }
 }
 
 /**
  * @brief 初始化物理内存
  * 
- * 找到所有可用内存，并将其用栈管理起来，以后请求内存就是从栈pop，归还内存就是push
  * 具体内存信息从multiboot中获取，方法如下：
+ * 1. 收集不可用的区间（0页、bootstrap、内核、multiboot信息、模块），按开始地址排序
+ * 2. 从multiboot给出的每个可用区间中减去不可用区间，得到空闲区间
+ * 3. 从空闲区间取出少量页放入栈中，用来为每个物理页分配PageFrame
+ * 4. 将空闲区间整段交给buddy，高端内存推迟到shell启动后由空闲进程在后台加入
  * 
  * @param multiboot 
  */
@@ -135,67 +424,424 @@ void PhysicalMemory::initialize(multiboot_info *multiboot)
 
     multiboot_mod_list *modules = (multiboot_mod_list *)(modulesMapped + modulesOffset);
 
+    PhysicalRange reserved[MAX_RESERVED_RANGES];
+    size_t reservedCount = 0;
+    addReservedRange(reserved, reservedCount, 0, PAGESIZE);
+    addReservedRange(reserved, reservedCount, (inwox_phy_addr_t)&bootstrapBegin, (inwox_phy_addr_t)&bootstrapEnd);
+    addReservedRange(reserved, reservedCount, (inwox_phy_addr_t)&kernelPhysicalBegin,
+                     (inwox_phy_addr_t)&kernelPhysicalEnd);
+    addReservedRange(reserved, reservedCount, multiboot->mmap_addr, multiboot->mmap_addr + multiboot->mmap_length);
+    addReservedRange(reserved, reservedCount, multiboot->mods_addr,
+                     multiboot->mods_addr + multiboot->mods_count * sizeof(multiboot_mod_list));
+    for (size_t i = 0; i < multiboot->mods_count; i++) {
+        addReservedRange(reserved, reservedCount, modules[i].mod_start, modules[i].mod_end);
+    }
+
+    PhysicalRange freeRanges[MAX_FREE_RANGES];
+    size_t freeCount = 0;
+    uint64_t highestAddress = 0;
     while (mmap < mmapEnd) {
         multiboot_mmap_entry *mmapEntry = (multiboot_mmap_entry *)mmap;
         if (mmapEntry->type == MULTIBOOT_MEMORY_AVAILABLE && mmapEntry->base_addr + mmapEntry->length <= UINTPTR_MAX) {
-            inwox_phy_addr_t addr = (inwox_phy_addr_t)mmapEntry->base_addr;
-            for (uint64_t i = 0; i < mmapEntry->length; i += PAGESIZE) {
-                if (isUsedByModule(addr + i, modules, multiboot->mods_count) || isUsedByKernel(addr + i) ||
-                    isUsedByMultiboot(addr + i, multiboot)) {
-                    continue;
-                }
-                pushPageFrame(addr + i);
+            uint64_t start = ALIGN_UP(mmapEntry->base_addr, PAGESIZE);
+            uint64_t end = (mmapEntry->base_addr + mmapEntry->length) & ~0xFFF;
+            if (end > highestAddress) {
+                highestAddress = end;
             }
+            subtractReservedRanges(reserved, reservedCount, start, end, freeRanges, freeCount);
         }
         mmap += mmapEntry->size + 4;
     }
     kernelSpace->unmapPhysical(mmapMapped, mmapSize);
     kernelSpace->unmapPhysical(modulesMapped, modulesSize);
-    Print::printf("Free Memory: %u KiB\n", stackUsed * 4);
+
+    // 页信息表需要的页，加上映射它所需的页表，以及分配段描述符可能用到的页，先放入栈中
+    frameCount = highestAddress / PAGESIZE;
+    size_t framesSize = ALIGN_UP(frameCount * sizeof(PageFrame), PAGESIZE);
+    size_t bootstrapFrames = framesSize / PAGESIZE + framesSize / 0x400000 + 4;
+    for (size_t i = 0; i < freeCount && bootstrapFrames; i++) {
+        while (bootstrapFrames && freeRanges[i].start < freeRanges[i].end) {
+            pushPageFrame(freeRanges[i].start);
+            freeRanges[i].start += PAGESIZE;
+            bootstrapFrames--;
+        }
+    }
+    frames = (PageFrame *)kernelSpace->mapMemory(framesSize, PROT_READ | PROT_WRITE);
+    memset(frames, 0, framesSize);
+    for (unsigned int order = 0; order <= BUDDY_MAX_ORDER; order++) {
+        freeLists[order] = FRAME_NONE;
+    }
+
+    ScopedLock lock(&mutex);
+    for (size_t i = 0; i < freeCount; i++) {
+        uint64_t start = freeRanges[i].start;
+        uint64_t end = freeRanges[i].end;
+        if (start < EARLY_MEMORY_LIMIT) {
+            uint64_t earlyEnd = end < EARLY_MEMORY_LIMIT ? end : EARLY_MEMORY_LIMIT;
+            buddyAddRange(start, earlyEnd);
+            start = earlyEnd;
+        }
+        if (start < end) {
+            deferredRanges[deferredRangeCount].start = start;
+            deferredRanges[deferredRangeCount++].end = end;
+            deferredFrames += (end - start) / PAGESIZE;
+        }
+    }
+    Print::printf("Free Memory: %u KiB, %u KiB deferred\n", (buddyFreeFrames + stackUsed) * 4, deferredFrames * 4);
 }
 
 /**
- * @brief 将物理内存压入物理内存管理栈中
+ * @brief 是否有需要空闲进程在后台完成的工作
  * 
- * 当管理栈还有空间时，直接将物理内存压栈，若栈空间用完，则将此页作为物理内存管理栈的一部分
- * 合并入栈的虚拟地址空间
+ * @return true 还有推迟加入的内存，或预先清零的页不足
+ * @return false 没有
+ */
+bool PhysicalMemory::hasBackgroundWork()
+{
+    return deferredRangeCount > 0 || (zeroedCount < ZERO_POOL_LOW && (stackUsed || buddyFreeFrames));
+}
+
+/**
+ * @brief 由空闲进程调用，在后台完成一小部分工作
+ * 
+ * 每次将一部分推迟的高端内存加入buddy，或将一页内存清零后放入预先清零的页中
+ * 
+ * @return true 完成了一部分工作
+ * @return false 没有需要完成的工作
+ */
+bool PhysicalMemory::doBackgroundWork()
+{
+    kthread_mutex_lock(&mutex);
+    if (addDeferredChunk()) {
+        kthread_mutex_unlock(&mutex);
+        return true;
+    }
+    if (zeroedCount >= ZERO_POOL_SIZE) {
+        kthread_mutex_unlock(&mutex);
+        return false;
+    }
+    if (!stackUsed) {
+        refillStack();
+    }
+    inwox_phy_addr_t physicalAddress = stackPop();
+    kthread_mutex_unlock(&mutex);
+    if (!physicalAddress) {
+        return false;
+    }
+
+    // 清零时不持有锁，其他进程可以正常分配内存
+    AddressSpace::zeroPhysicalPage(physicalAddress);
+    ScopedLock lock(&mutex);
+    if (zeroedCount < ZERO_POOL_SIZE) {
+        zeroedFrames[zeroedCount++] = physicalAddress;
+    } else {
+        stackPush(physicalAddress);
+    }
+    return true;
+}
+
+/**
+ * @brief 分配一页已清零的物理内存
+ * 
+ * 优先使用预先清零的页，没有时分配后立即清零
+ * 
+ * @return inwox_phy_addr_t 分配到的物理内存
+ */
+inwox_phy_addr_t PhysicalMemory::popZeroedPageFrame()
+{
+    kthread_mutex_lock(&mutex);
+    if (zeroedCount) {
+        inwox_phy_addr_t result = zeroedFrames[--zeroedCount];
+        kthread_mutex_unlock(&mutex);
+        return result;
+    }
+    kthread_mutex_unlock(&mutex);
+
+    inwox_phy_addr_t result = popPageFrame();
+    if (result) {
+        AddressSpace::zeroPhysicalPage(result);
+    }
+    return result;
+}
+
+/**
+ * @brief 批量分配已清零的物理内存
+ * 
+ * 预先清零的页不够时，其余部分分配后立即清零
+ * 
+ * @param count 需要的页数
+ * @param frameList 存放分配到的物理页
+ * @return true 分配成功
+ * @return false 内存不足，此时不分配任何内存
+ */
+bool PhysicalMemory::popZeroedPageFrames(size_t count, inwox_phy_addr_t *frameList)
+{
+    kthread_mutex_lock(&mutex);
+    size_t fromPool = count < zeroedCount ? count : zeroedCount;
+    zeroedCount -= fromPool;
+    memcpy(frameList, &zeroedFrames[zeroedCount], fromPool * sizeof(inwox_phy_addr_t));
+    kthread_mutex_unlock(&mutex);
+
+    if (fromPool < count) {
+        if (!popPageFrames(count - fromPool, frameList + fromPool)) {
+            pushPageFrames(fromPool, frameList);
+            return false;
+        }
+        for (size_t i = fromPool; i < count; i++) {
+            AddressSpace::zeroPhysicalPage(frameList[i]);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 归还一页物理内存
+ * 
+ * 压入栈中缓存，栈中缓存过多时批量归还buddy
  * 
  * @param physicalAddress 待归还物理内存管理器的内存
  */
 void PhysicalMemory::pushPageFrame(inwox_phy_addr_t physicalAddress)
 {
     ScopedLock lock(&mutex);
-    if (unlikely(stackLeft == 0)) {
-        kernelSpace->mapAt((inwox_vir_addr_t)stack - stackUsed * 4 - PAGESIZE, physicalAddress,
-                                 PROT_READ | PROT_WRITE);
-        stackLeft += 1024;
-    } else {
-        stack[-++stackUsed] = physicalAddress;
-        stackLeft--;
+    stackPush(physicalAddress);
+    // 初始化完成前，所有页都先放在栈中
+    if (frames && stackUsed > STACK_CACHE_HIGH) {
+        drainStack(STACK_CACHE_LOW);
     }
 }
 
 /**
- * @brief 将物理内存从物理内存管理栈弹出
+ * @brief 分配一页物理内存
+ * 
+ * 优先从栈中取，栈为空时从buddy批量补充
  * 
  * @return inwox_phy_addr_t 分配到的物理内存
  */
 inwox_phy_addr_t PhysicalMemory::popPageFrame()
 {
     ScopedLock lock(&mutex);
-    if (unlikely(stackUsed == 0)) {
-        if (likely(stackLeft > 0)) {
-            inwox_vir_addr_t virtualAddress = (inwox_vir_addr_t)stack - stackLeft * 4;
-            inwox_phy_addr_t result = kernelSpace->getPhysicalAddress(virtualAddress);
-            kernelSpace->unMap(virtualAddress);
-            stackLeft -= 1024;
-            return result;
+    if (unlikely(stackUsed == 0) && frames) {
+        refillStack();
+    }
+    inwox_phy_addr_t result = stackPop();
+    if (!result && zeroedCount) {
+        result = zeroedFrames[--zeroedCount];
+    }
+    if (!result) {
+        Print::printf("Out of Memory\n");
+    }
+    return result;
+}
+
+/**
+ * @brief 批量归还物理内存，需持有mutex
+ * 
+ * 栈中还能缓存的部分整段复制到栈顶，其余直接归还buddy
+ * 
+ * @param count 页数
+ * @param frameList 待归还的物理页
+ */
+static void pushFrames(size_t count, const inwox_phy_addr_t *frameList)
+{
+    // 初始化完成前，所有页都先放在栈中
+    if (unlikely(!frames)) {
+        for (size_t i = 0; i < count; i++) {
+            stackPush(frameList[i]);
+        }
+        return;
+    }
+    size_t toStack = stackUsed < STACK_CACHE_HIGH ? STACK_CACHE_HIGH - stackUsed : 0;
+    if (toStack > stackLeft) {
+        toStack = stackLeft;
+    }
+    if (toStack > count) {
+        toStack = count;
+    }
+    stackUsed += toStack;
+    stackLeft -= toStack;
+    memcpy(&stack[-stackUsed], frameList, toStack * sizeof(inwox_phy_addr_t));
+    for (size_t i = toStack; i < count; i++) {
+        buddyFree(frameList[i] / PAGESIZE, 0);
+    }
+}
+
+/**
+ * @brief 批量分配物理内存
+ * 
+ * 只加锁一次，先从栈顶复制一段缓存的页，不够的部分直接从buddy按块分配
+ * 
+ * @param count 需要的页数
+ * @param frameList 存放分配到的物理页
+ * @return true 分配成功
+ * @return false 内存不足，此时不分配任何内存
+ */
+bool PhysicalMemory::popPageFrames(size_t count, inwox_phy_addr_t *frameList)
+{
+    ScopedLock lock(&mutex);
+    size_t fromStack = count < stackUsed ? count : stackUsed;
+    // 栈向低地址生长，栈顶的fromStack个元素在内存中是连续的
+    memcpy(frameList, &stack[-stackUsed], fromStack * sizeof(inwox_phy_addr_t));
+    stackUsed -= fromStack;
+    stackLeft += fromStack;
+
+    size_t i = fromStack;
+    while (frames && i < count) {
+        unsigned int order = 0;
+        while (order < BUDDY_MAX_ORDER && (2u << order) <= count - i) {
+            order++;
+        }
+        size_t frame = buddyAllocate(order);
+        while (frame == FRAME_NONE && order > 0) {
+            frame = buddyAllocate(--order);
+        }
+        if (frame == FRAME_NONE) {
+            if (addDeferredChunk()) {
+                continue;
+            }
+            // 最后使用预先清零的页
+            while (i < count && zeroedCount) {
+                frameList[i++] = zeroedFrames[--zeroedCount];
+            }
+            break;
+        }
+        for (size_t j = 0; j < (1u << order); j++) {
+            frameList[i++] = (frame + j) * PAGESIZE;
+        }
+    }
+    if (i < count) {
+        // 已取得的页可能来自栈和清零池，按普通页归还，初始化前也能正确处理
+        pushFrames(i, frameList);
+        Print::printf("Out of Memory\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 批量归还物理内存
+ * 
+ * @param count 页数
+ * @param frameList 待归还的物理页
+ */
+void PhysicalMemory::pushPageFrames(size_t count, const inwox_phy_addr_t *frameList)
+{
+    ScopedLock lock(&mutex);
+    pushFrames(count, frameList);
+}
+
+/**
+ * @brief 分配物理连续的内存块
+ * 
+ * 块大小为2^order页，首地址按块大小对齐
+ * 
+ * @param order 块的阶数，不能超过BUDDY_MAX_ORDER
+ * @return inwox_phy_addr_t 块的首地址，没有足够大的连续内存时返回0
+ */
+inwox_phy_addr_t PhysicalMemory::allocContiguous(unsigned int order)
+{
+    assert(order <= BUDDY_MAX_ORDER);
+    ScopedLock lock(&mutex);
+    size_t frame = buddyAllocate(order);
+    if (frame == FRAME_NONE) {
+        // 栈中缓存的页可能正是缺少的部分，全部归还后合并再试一次
+        drainStack(0);
+        frame = buddyAllocate(order);
+    }
+    while (frame == FRAME_NONE && addDeferredChunk()) {
+        frame = buddyAllocate(order);
+    }
+    if (frame == FRAME_NONE) {
+        return 0;
+    }
+    return frame * PAGESIZE;
+}
+
+/**
+ * @brief 归还由allocContiguous分配的内存块
+ * 
+ * @param physicalAddress 块的首地址
+ * @param order 分配时的阶数
+ */
+void PhysicalMemory::freeContiguous(inwox_phy_addr_t physicalAddress, unsigned int order)
+{
+    assert(order <= BUDDY_MAX_ORDER);
+    assert(!(physicalAddress & ((PAGESIZE << order) - 1)));
+    ScopedLock lock(&mutex);
+    buddyFree(physicalAddress / PAGESIZE, order);
+}
+
+/**
+ * @brief 增加物理页的引用计数
+ * 
+ * 物理页被另一个地址空间共享（如写时复制的fork）时调用
+ * 
+ * @param physicalAddress 被共享的物理页
+ */
+void PhysicalMemory::retainPageFrame(inwox_phy_addr_t physicalAddress)
+{
+    size_t index = physicalAddress / PAGESIZE;
+    assert(index < frameCount);
+    ScopedLock lock(&mutex);
+    assert(frames[index].references < UINT16_MAX);
+    frames[index].references++;
+}
+
+/**
+ * @brief 释放对物理页的一个引用
+ * 
+ * 若该页仍被其他地址空间共享，只减少引用计数，否则将其归还物理内存管理栈
+ * 
+ * @param physicalAddress 待释放的物理页
+ */
+void PhysicalMemory::releasePageFrame(inwox_phy_addr_t physicalAddress)
+{
+    size_t index = physicalAddress / PAGESIZE;
+    if (index < frameCount) {
+        kthread_mutex_lock(&mutex);
+        if (frames[index].references) {
+            frames[index].references--;
+            kthread_mutex_unlock(&mutex);
+            return;
+        }
+        kthread_mutex_unlock(&mutex);
+    }
+    pushPageFrame(physicalAddress);
+}
+
+/**
+ * @brief 判断物理页是否被多个地址空间共享
+ * 
+ * @param physicalAddress 待判断的物理页
+ * @return true 被共享，写入前需要复制
+ * @return false 只有一个使用者
+ */
+bool PhysicalMemory::isPageFrameShared(inwox_phy_addr_t physicalAddress)
+{
+    size_t index = physicalAddress / PAGESIZE;
+    ScopedLock lock(&mutex);
+    return index < frameCount && frames[index].references > 0;
+}
+
+/**
+ * @brief 批量释放对物理页的引用
+ * 
+ * 只加锁一次，仍被共享的页只减少引用计数，其余页批量归还
+ * 
+ * @param count 页数
+ * @param frameList 待释放的物理页，仍被共享的页会从中移除
+ */
+void PhysicalMemory::releasePageFrames(size_t count, inwox_phy_addr_t *frameList)
+{
+    ScopedLock lock(&mutex);
+    size_t unshared = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t index = frameList[i] / PAGESIZE;
+        if (index < frameCount && frames[index].references) {
+            frames[index].references--;
         } else {
-            Print::printf("Out of Memory\n");
-            return 0;
+            frameList[unshared++] = frameList[i];
         }
-    } else {
-        stackLeft++;
-        return stack[-stackUsed--];
     }
+    pushFrames(unshared, frameList);
 }
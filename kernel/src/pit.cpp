@@ -30,6 +30,7 @@
 #include <inwox/kernel/pit.h>
 #include <inwox/kernel/port.h>
 #include <inwox/kernel/print.h>
+#include <inwox/kernel/vdata.h>
 
 #define PIT_FREQUENCY 1193182 // Hz
 #define HZ            1000    // 每秒嘀嗒次数
@@ -55,6 +56,7 @@ static int64_t pit_ticker = 0;
 static void irqHandler(struct context *)
 {
     pit_ticker++;
+    VData::tick(pit_ticker, nanoseconds);
     for (size_t i = 0; i < NUM_TIMERS; i++) {
         if (timers[i]) {
             timers[i]->advance(nanoseconds);
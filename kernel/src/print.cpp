@@ -53,3 +53,14 @@ void Print::printf(const char *format, ...)
     vcbprintf(nullptr, print_callback, format, vl);
     va_end(vl);
 }
+
+/**
+ * libk中malloc_stats等输出统计信息时使用
+ */
+extern "C" void __mallocPrintf(const char *format, ...)
+{
+    va_list vl;
+    va_start(vl, format);
+    vcbprintf(nullptr, print_callback, format, vl);
+    va_end(vl);
+}
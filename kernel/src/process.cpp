@@ -34,15 +34,51 @@
 #include <sys/stat.h>
 #include <inwox/kernel/elf.h>
 #include <inwox/kernel/file.h>
+#include <inwox/kernel/kmemcache.h>
 #include <inwox/kernel/physicalmemory.h>
 #include <inwox/kernel/print.h>
 #include <inwox/kernel/process.h>
 #include <inwox/kernel/terminal.h>
+#include <inwox/kernel/vdata.h>
 
 Process *Process::current;
 static Process *firstProcess;
 static Process *idleProcess;
 static pid_t nextPid = 0;
+
+#define CPUID_FXSR       (1 << 24)
+#define CPUID_SSE2       (1 << 26)
+#define CR0_MP           (1 << 1)
+#define CR0_EM           (1 << 2)
+#define CR4_OSFXSR       (1 << 9)
+#define CR4_OSXMMEXCPT   (1 << 10)
+
+/* CPU支持并开启了SSE时，进程切换需要保存和恢复SSE寄存器 */
+static bool fpuEnabled = false;
+/* fninit之后的寄存器状态，新进程和execute之后的进程从此状态开始 */
+static char initialFpuState[FPU_STATE_SIZE] ALIGNED(16);
+
+/**
+ * 检测CPU是否支持fxsave和SSE2，支持则在cr0和cr4中开启，使用户程序可以使用SSE2指令
+ * 内核本身不使用SSE寄存器，只在进程切换时保存和恢复
+ */
+static void initializeFpu()
+{
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    if (!(edx & CPUID_FXSR) || !(edx & CPUID_SSE2)) {
+        return;
+    }
+    uintptr_t cr0, cr4;
+    __asm__ __volatile__("mov %%cr0, %0" : "=r"(cr0));
+    cr0 = (cr0 & ~CR0_EM) | CR0_MP;
+    __asm__ __volatile__("mov %0, %%cr0" ::"r"(cr0));
+    __asm__ __volatile__("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    __asm__ __volatile__("mov %0, %%cr4" ::"r"(cr4));
+    __asm__ __volatile__("fninit\n\tfxsave %0" : "=m"(initialFpuState));
+    fpuEnabled = true;
+}
 /**
  * 这里的进程我们只指一个程序的基本可执行实体，并不代表线程的容器（区别于现代面向线程设计的系统）。
  * 当前的INWOX中进程控制块比较简单，包括一个独立的地址空间、运行上下文、指向下一个进程的指针和内核堆栈、用户堆栈
@@ -67,6 +103,7 @@ Process::Process()
     status = 0;
     childrenMutex = KTHREAD_MUTEX_INITIALIZER;
     umask = S_IWGRP | S_IWOTH;
+    memcpy(fpuState, initialFpuState, sizeof(fpuState));
 }
 
 Process::~Process()
@@ -76,12 +113,28 @@ Process::~Process()
     free(children);
 }
 
+/**
+ * 进程控制块大小固定，fork时频繁创建，从专用的对象缓存分配
+ */
+static KmemCache processCache("process", sizeof(Process));
+
+void *Process::operator new(size_t /* size */)
+{
+    return processCache.allocate();
+}
+
+void Process::operator delete(void *object)
+{
+    processCache.free(object);
+}
+
 /**
  * 进程初始化
  * 创建空闲进程（没有其他任务执行时执行的进程）
  */
 void Process::initialize(FileDescription *rootFd)
 {
+    initializeFpu();
     idleProcess = new Process();
     idleProcess->addressSpace = kernelSpace;
     idleProcess->rootFd = rootFd;
@@ -117,12 +170,10 @@ uintptr_t Process::loadELF(uintptr_t elf, AddressSpace *newAddressSpace)
         ptrdiff_t offset = programHeader[i].p_paddr - loadAddressAligned;
         const void *src = (void *)(elf + programHeader[i].p_offset);
         size_t size = ALIGN_UP(programHeader[i].p_memsz + offset, PAGESIZE);
-        /* 将申请到的物理内存映射到连续虚拟内存 */
+        /* 将申请到的物理内存映射到连续虚拟内存，用户地址空间分配到的内存已预先清零，bss不需要再设为0 */
         newAddressSpace->mapMemory(loadAddressAligned, size, PROT_READ | PROT_WRITE | PROT_EXEC);
         inwox_vir_addr_t dest =
             kernelSpace->mapFromOtherAddressSpace(newAddressSpace, loadAddressAligned, size, PROT_WRITE);
-        /* 将申请到的虚拟内存保存的内容全部设为0 */
-        memset((void *)(dest + offset), 0, programHeader[i].p_memsz);
         /* 将p_offset开始，长度为p_filesz的内容复制到目标内存 */
         memcpy((void *)(dest + offset), src, programHeader[i].p_filesz);
         /* 取消映射 */
@@ -139,13 +190,20 @@ uintptr_t Process::loadELF(uintptr_t elf, AddressSpace *newAddressSpace)
  */
 struct context *Process::schedule(struct context *context)
 {
+    // execute之后的进程从初始的寄存器状态开始，不保存旧程序的寄存器
     if (likely(!current->contextChanged)) {
         current->interruptContext = context;
+        if (fpuEnabled) {
+            __asm__ __volatile__("fxsave %0" : "=m"(current->fpuState));
+        }
     } else {
         current->contextChanged = false;
     }
     if (current->next) {
         current = current->next;
+    } else if (current != idleProcess && PhysicalMemory::hasBackgroundWork()) {
+        // 每轮调度结束时，若有后台工作，让空闲进程运行一个时间片
+        current = idleProcess;
     } else {
         if (firstProcess) {
             current = firstProcess;
@@ -155,6 +213,10 @@ struct context *Process::schedule(struct context *context)
     }
     setKernelStack((uintptr_t)current->kstack + PAGESIZE);
     current->addressSpace->activate();
+    VData::data->pid = current->pid;
+    if (fpuEnabled) {
+        __asm__ __volatile__("fxrstor %0" ::"m"(current->fpuState));
+    }
     return current->interruptContext;
 }
 
@@ -252,6 +314,7 @@ int Process::execute(Vnode *vnode, char *const argv[], char *const envp[])
     if (this == current) {
         contextChanged = true;
     }
+    memcpy(fpuState, initialFpuState, sizeof(fpuState));
 
     kstack = newkstack;
 
@@ -300,6 +363,13 @@ void Process::exit(int status)
 Process *Process::regfork(int flags, struct regfork *registers)
 {
     (void)flags;
+    // 先fork地址空间，内存不足时不创建进程
+    AddressSpace *newAddressSpace = addressSpace->fork();
+    if (!newAddressSpace) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+
     Process *process = new Process();
     process->parent = this;
     kthread_mutex_lock(&childrenMutex);
@@ -325,9 +395,12 @@ Process *Process::regfork(int flags, struct regfork *registers)
     process->interruptContext->cs = 0x1B;
     process->interruptContext->eflags = 0x200;
     process->interruptContext->ss = 0x23;
+    // 子进程继承当前的SSE寄存器
+    if (fpuEnabled) {
+        __asm__ __volatile__("fxsave %0" : "=m"(process->fpuState));
+    }
 
-    // fork地址空间
-    process->addressSpace = addressSpace->fork();
+    process->addressSpace = newAddressSpace;
 
     // fork文件描述符
     for (size_t i = 0; i < OPEN_MAX; i++) {
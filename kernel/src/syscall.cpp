@@ -60,6 +60,8 @@ static const void *syscallList[NUM_SYSCALLS] = {
     (void*) Syscall::fchdirat,
     (void*) Syscall::uname,
     (void*) Syscall::fstat,
+    (void*) Syscall::mremap,
+    (void*) Syscall::ring_enter,
 };
 
 /**
@@ -162,6 +164,9 @@ pid_t Syscall::regfork(int flags, struct regfork *registers)
         return -1;
     }
     Process *newProcess = Process::current->regfork(flags, registers);
+    if (!newProcess) {
+        return -1;
+    }
     return newProcess->pid;
 }
 
@@ -275,10 +280,10 @@ static void *mmapImplementation(void * /*addr*/, size_t size, int protection, in
         return MAP_FAILED;
     }
 
-    // 对于匿名映射，在当前进程的地址空间分配一块指定大小、保护模式的内存
+    // 对于匿名映射，在当前进程的地址空间预留一块指定大小、保护模式的内存，物理内存在首次访问时分配
     if (flags & MAP_ANONYMOUS) {
         AddressSpace *addressSpace = Process::current->addressSpace;
-        return (void *)addressSpace->mapMemory(size, protection);
+        return (void *)addressSpace->reserveMemory(size, protection);
     }
 
     // 实现其他flags
@@ -322,6 +327,124 @@ int Syscall::munmap(void *addr, size_t size)
     return 0;
 }
 
+/**
+ * @brief 系统调用mremap
+ * 
+ * 改变一段匿名映射的大小，扩大时优先原地扩大，空间不足且允许移动时将页表项移动到新地址，数据不需要复制
+ * 
+ * @param oldAddress 原映射开始地址，必须是页面的整数倍且是一次mmap返回的地址
+ * @param oldSize 原映射长度
+ * @param newSize 新长度
+ * @param flags MREMAP_MAYMOVE表示允许移动映射
+ * @return void* 改变大小后映射的地址，失败返回MAP_FAILED
+ */
+void *Syscall::mremap(void *oldAddress, size_t oldSize, size_t newSize, int flags)
+{
+    if (oldSize == 0 || newSize == 0 || (inwox_vir_addr_t)oldAddress & 0xFFF || flags & ~MREMAP_MAYMOVE) {
+        errno = EINVAL;
+        return MAP_FAILED;
+    }
+
+    AddressSpace *addressSpace = Process::current->addressSpace;
+    return (void *)addressSpace->remapMemory((inwox_vir_addr_t)oldAddress, oldSize, newSize, flags);
+}
+
+/**
+ * @brief 执行一个提交项
+ *
+ * 系统调用处理程序都按cdecl调用，多传的参数会被忽略，因此可以统一按5个参数调用。
+ * exit、regfork、execve会改变调用者的执行流，ring_enter会递归，都不能批量执行
+ *
+ * @param sqe 提交项
+ * @return intptr_t 系统调用返回值
+ */
+static intptr_t ringExecute(const struct ring_sqe *sqe)
+{
+    switch (sqe->sqe_syscall) {
+    case SYSCALL_EXIT:
+    case SYSCALL_REGFORK:
+    case SYSCALL_EXECVE:
+    case SYSCALL_RING_ENTER:
+        errno = ENOSYS;
+        return -1;
+    }
+    if (sqe->sqe_syscall >= NUM_SYSCALLS) {
+        errno = ENOSYS;
+        return -1;
+    }
+
+    typedef intptr_t (*Handler)(uintptr_t, uintptr_t, uintptr_t, uintptr_t, uintptr_t);
+    Handler handler = (Handler)syscallList[sqe->sqe_syscall];
+    return handler(sqe->sqe_args[0], sqe->sqe_args[1], sqe->sqe_args[2], sqe->sqe_args[3], sqe->sqe_args[4]);
+}
+
+/**
+ * @brief 判断用户程序给出的数组是否完全位于0xC0000000以下的用户空间
+ *
+ * @param address 数组开始地址
+ * @param count 元素个数
+ * @param size 每个元素的大小
+ * @return true 数组在用户空间内，计算结束地址时不会溢出
+ */
+static bool isUserArray(const void *address, size_t count, size_t size)
+{
+    uintptr_t start = (uintptr_t)address;
+    return start < 0xC0000000 && count <= (0xC0000000 - start) / size;
+}
+
+/**
+ * @brief 系统调用ring_enter
+ *
+ * 依次执行提交环中的系统调用并把结果写入完成环，一批系统调用只需进入一次内核。
+ * 每项执行后立即更新r_sqhead和r_cqtail，完成环满时停止，剩余的提交项留待下次执行
+ * 内核直接读写ring及其中的两个数组，它们必须都在用户空间，否则用户程序可以借完成项写入内核内存，
+ * 数组地址和项数只读取一次，检查后用户程序再修改也不会影响
+ *
+ * @param ring 用户程序中的提交/完成环
+ * @param count 最多执行的提交项个数
+ * @return int 执行的提交项个数，r_entries不是2的幂时返回-1并设置EINVAL，环不在用户空间时设置EFAULT
+ */
+int Syscall::ring_enter(struct ring *ring, unsigned int count)
+{
+    if (!isUserArray(ring, 1, sizeof(struct ring))) {
+        errno = EFAULT;
+        return -1;
+    }
+    uint32_t entries = ring->r_entries;
+    if (entries == 0 || (entries & (entries - 1))) {
+        errno = EINVAL;
+        return -1;
+    }
+    const struct ring_sqe *sq = ring->r_sq;
+    struct ring_cqe *cq = ring->r_cq;
+    if (!isUserArray(sq, entries, sizeof(struct ring_sqe)) || !isUserArray(cq, entries, sizeof(struct ring_cqe))) {
+        errno = EFAULT;
+        return -1;
+    }
+
+    uint32_t mask = entries - 1;
+    uint32_t sqHead = ring->r_sqhead;
+    uint32_t cqTail = ring->r_cqtail;
+    unsigned int done = 0;
+    while (done < count && sqHead != ring->r_sqtail && cqTail - ring->r_cqhead < entries) {
+        // 先复制提交项，执行期间用户程序修改它不会影响结果
+        struct ring_sqe sqe = sq[sqHead & mask];
+        errno = 0;
+        intptr_t result = ringExecute(&sqe);
+
+        struct ring_cqe *cqe = &cq[cqTail & mask];
+        cqe->cqe_userdata = sqe.sqe_userdata;
+        cqe->cqe_result = result;
+        cqe->cqe_errno = errno;
+        ring->r_sqhead = ++sqHead;
+        ring->r_cqtail = ++cqTail;
+        done++;
+    }
+
+    errno = 0;
+    return done;
+}
+
 /**
  * INWOX不能处理的系统调用
  */
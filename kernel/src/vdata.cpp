@@ -0,0 +1,218 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * kernel/src/vdata.cpp
+ * 共享数据页，用户程序读取时间和pid不需要系统调用
+ */
+
+#include <string.h>
+#include <inwox/kernel/addressspace.h>
+#include <inwox/kernel/port.h>
+#include <inwox/kernel/vdata.h>
+
+#define CPUID_TSC (1 << 4)
+/* 用前100次时钟中断（约0.1秒）内的TSC增量校准TSC频率 */
+#define CALIBRATION_TICKS 100
+
+/* CMOS实时时钟，先向地址端口写寄存器号，再从数据端口读取 */
+#define CMOS_ADDRESS 0x70
+#define CMOS_DATA    0x71
+#define RTC_SECOND   0x00
+#define RTC_MINUTE   0x02
+#define RTC_HOUR     0x04
+#define RTC_DAY      0x07
+#define RTC_MONTH    0x08
+#define RTC_YEAR     0x09
+#define RTC_STATUS_A 0x0A
+#define RTC_STATUS_B 0x0B
+#define RTC_UPDATING (1 << 7) // 状态A：RTC正在更新，此时读到的值可能不一致
+#define RTC_24HOUR   (1 << 1) // 状态B：24小时制，否则小时的最高位表示下午
+#define RTC_BINARY   (1 << 2) // 状态B：二进制，否则为BCD码
+#define RTC_PM       (1 << 7)
+
+struct vdata *VData::data;
+
+static bool hasTsc = false;
+static uint64_t calibrationTsc;
+static uint64_t calibrationTicks;
+
+static inline uint64_t readTsc()
+{
+    uint32_t low, high;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+static uint8_t readCmos(uint8_t reg)
+{
+    Hardwarecommunication::outportb(CMOS_ADDRESS, reg);
+    return Hardwarecommunication::inportb(CMOS_DATA);
+}
+
+struct rtcTime {
+    uint8_t second;
+    uint8_t minute;
+    uint8_t hour;
+    uint8_t day;
+    uint8_t month;
+    uint8_t year;
+};
+
+static void readRtcRegisters(struct rtcTime &time)
+{
+    while (readCmos(RTC_STATUS_A) & RTC_UPDATING) {
+    }
+    time.second = readCmos(RTC_SECOND);
+    time.minute = readCmos(RTC_MINUTE);
+    time.hour = readCmos(RTC_HOUR);
+    time.day = readCmos(RTC_DAY);
+    time.month = readCmos(RTC_MONTH);
+    time.year = readCmos(RTC_YEAR);
+}
+
+static uint8_t fromBcd(uint8_t value)
+{
+    return (value & 0xF) + (value >> 4) * 10;
+}
+
+/**
+ * @brief 计算公历日期距1970-01-01的天数
+ *
+ * 把3月作为一年的第一个月，闰日落在年末，每400年为一个周期
+ */
+static int daysFromCivil(int year, unsigned int month, unsigned int day)
+{
+    year -= month <= 2;
+    int era = year / 400;
+    unsigned int yearOfEra = year - era * 400;
+    unsigned int dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + (int)dayOfEra - 719468;
+}
+
+/**
+ * @brief 读取CMOS实时时钟
+ *
+ * 连续两次读到相同的值才认为没有赶上RTC更新。RTC的时间按UTC处理，
+ * 年份寄存器只有两位，世纪寄存器的位置不统一，按21世纪计算
+ *
+ * @return __time_t 距1970-01-01的秒数，RTC的值无效时返回0
+ */
+static __time_t readRtc()
+{
+    struct rtcTime time, last;
+    readRtcRegisters(time);
+    do {
+        last = time;
+        readRtcRegisters(time);
+    } while (memcmp(&time, &last, sizeof(time)) != 0);
+
+    uint8_t status = readCmos(RTC_STATUS_B);
+    bool pm = !(status & RTC_24HOUR) && (time.hour & RTC_PM);
+    time.hour &= ~RTC_PM;
+    if (!(status & RTC_BINARY)) {
+        time.second = fromBcd(time.second);
+        time.minute = fromBcd(time.minute);
+        time.hour = fromBcd(time.hour);
+        time.day = fromBcd(time.day);
+        time.month = fromBcd(time.month);
+        time.year = fromBcd(time.year);
+    }
+    if (!(status & RTC_24HOUR)) {
+        time.hour = time.hour % 12 + (pm ? 12 : 0);
+    }
+    if (time.month < 1 || time.month > 12 || time.day < 1 || time.day > 31) {
+        return 0;
+    }
+
+    __time_t days = daysFromCivil(2000 + time.year, time.month, time.day);
+    return days * 86400 + time.hour * 3600 + time.minute * 60 + time.second;
+}
+
+/**
+ * 分配数据页，并映射到所有地址空间的VDATA_ADDRESS，从RTC读取开机时间
+ */
+void VData::initialize()
+{
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    hasTsc = edx & CPUID_TSC;
+
+    inwox_vir_addr_t page = kernelSpace->mapMemory(PAGESIZE, PROT_READ | PROT_WRITE);
+    memset((void *)page, 0, PAGESIZE);
+    // 此时时钟中断还未开始，ticks为0，RTC的时间即开机时间
+    ((struct vdata *)page)->bootTime = readRtc();
+    AddressSpace::mapSharedData(kernelSpace->getPhysicalAddress(page));
+    data = (struct vdata *)page;
+}
+
+/**
+ * @brief 计算TSC周期到纳秒的换算比例
+ *
+ * 选择尽量大的shift使scale仍能放入32位，这样TSC差值（不超过32位）乘以scale不会溢出64位
+ */
+static void calibrateTsc(uint64_t cyclesPerTick, uint32_t nsPerTick, uint32_t &scale, uint32_t &shift)
+{
+    shift = 32;
+    while (shift > 0 && ((uint64_t)nsPerTick << shift) / cyclesPerTick > UINT32_MAX) {
+        shift--;
+    }
+    scale = ((uint64_t)nsPerTick << shift) / cyclesPerTick;
+}
+
+/**
+ * @brief 时钟中断中调用，更新时钟
+ *
+ * 在关中断的中断处理程序中执行，只有一个写者
+ *
+ * @param ticks 开机起的时钟中断次数
+ * @param nsPerTick 每次时钟中断经过的纳秒数
+ */
+void VData::tick(uint64_t ticks, uint32_t nsPerTick)
+{
+    uint64_t tsc = hasTsc ? readTsc() : 0;
+    uint32_t scale = data->tscScale;
+    uint32_t shift = data->tscShift;
+    if (hasTsc && !scale) {
+        if (!calibrationTicks) {
+            calibrationTsc = tsc;
+            calibrationTicks = ticks;
+        } else if (ticks - calibrationTicks >= CALIBRATION_TICKS) {
+            uint64_t cyclesPerTick = (tsc - calibrationTsc) / (ticks - calibrationTicks);
+            if (cyclesPerTick) {
+                calibrateTsc(cyclesPerTick, nsPerTick, scale, shift);
+            }
+        }
+    }
+
+    data->sequence++;
+    __asm__ __volatile__("" ::: "memory");
+    data->ticks = ticks;
+    data->tscAtTick = tsc;
+    data->nsPerTick = nsPerTick;
+    data->tscScale = scale;
+    data->tscShift = shift;
+    __asm__ __volatile__("" ::: "memory");
+    data->sequence++;
+}
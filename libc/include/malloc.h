@@ -0,0 +1,71 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 - 2021 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * lib/include/malloc.h
+ * 内存分配器的调整参数和统计信息
+ */
+
+#ifndef MALLOC_H
+#define MALLOC_H
+
+#define __need_size_t
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 整个Big_MCB空闲时，若保留的空闲Big_MCB总大小不超过此值则保留，否则归还给系统 */
+#define M_TRIM_THRESHOLD -1
+/* 不小于此值的申请单独映射一块内存，释放时直接归还给系统 */
+#define M_MMAP_THRESHOLD -3
+/* 每N次分配采样一次调用者地址，0表示关闭采样。用户进程开启后在退出时输出采样结果 */
+#define M_PROFILE_INTERVAL -100
+
+/* 空闲块大小分布的分组数，第i组为[16 << i, 32 << i)字节，最后一组包含更大的块 */
+#define MALLINFO_HISTOGRAM_SIZE 16
+
+struct mallinfo {
+    size_t arena;    /* 所有Big_MCB的总字节数 */
+    size_t bigblks;  /* Big_MCB的个数 */
+    size_t ordblks;  /* 空闲块个数 */
+    size_t hblks;    /* 单独映射的块个数 */
+    size_t hblkhd;   /* 单独映射的总字节数 */
+    size_t uordblks; /* Big_MCB中使用中的字节数 */
+    size_t fordblks; /* Big_MCB中空闲的字节数 */
+    size_t cached;   /* 已释放但仍在缓存中的字节数 */
+    size_t keepcost; /* 整个空闲但保留未归还的Big_MCB字节数 */
+    size_t histogram[MALLINFO_HISTOGRAM_SIZE]; /* 空闲块按大小的分布 */
+};
+
+int mallopt(int, int);
+struct mallinfo mallinfo(void);
+void malloc_stats(void);
+void malloc_profile_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MALLOC_H */
@@ -44,10 +44,28 @@ extern "C" {
 struct __FILE {
     int fd;
     int flags;
+    /* 缓冲方式，_IOFBF、_IOLBF或_IONBF，第一次读写时确定 */
+    int bufferMode;
+    unsigned char *buffer;
+    size_t bufferSize;
+    /* 读缓冲中下一个未读字节和有效数据的结尾 */
+    size_t readPosition;
+    size_t readEnd;
+    /* 写缓冲中尚未写出的字节数 */
+    size_t writePosition;
+    /* 无缓冲时使用的单字节缓冲 */
+    unsigned char singleByte;
+    /* fdopen打开的流组成链表，用于退出时刷新 */
+    struct __FILE *prev;
+    struct __FILE *next;
 };
 
 #define FILE_FLAG_EOF (1 << 0)
 #define FILE_FLAG_ERROR (1 << 1)
+/* 已确定缓冲方式 */
+#define FILE_FLAG_BUFFERED (1 << 2)
+/* 缓冲区由setvbuf的调用者提供，不需要释放 */
+#define FILE_FLAG_USER_BUFFER (1 << 3)
 
 /* 标准流 */
 extern FILE *stdin;
@@ -112,6 +130,9 @@ int vdprintf(int fd, const char *__restrict format, __gnuc_va_list vl);
 int vfprintf(FILE *__restrict stream, const char *__restrict format, __gnuc_va_list vl);
 int vsprintf(char *__restrict s, const char *__restrict format, __gnuc_va_list vl);
 int vsnprintf(char *__restrict s, size_t n, const char *__restrict format, __gnuc_va_list vl);
+/* 下边两个函数格式化输出到新分配的内存，由调用者free */
+int asprintf(char **__restrict strp, const char *__restrict format, ...);
+int vasprintf(char **__restrict strp, const char *__restrict format, __gnuc_va_list vl);
 /* 下边四个函数从stdout/file/buffer格式化读取字节流 */
 int scanf(const char *__restrict format, ...);
 int fscanf(FILE *__restrict stream, const char *__restrict format);
@@ -131,6 +152,9 @@ int fgetc(FILE *stream);
 int getc(FILE *stream);
 /* 从文件中读取一行字节流 */
 char *fgets(char *__restrict s, int n, FILE *__restrict stream);
+/* 读取到分隔符或换行为止，空间不够时扩大*lineptr */
+ssize_t getdelim(char **__restrict lineptr, size_t *__restrict n, int delimiter, FILE *__restrict stream);
+ssize_t getline(char **__restrict lineptr, size_t *__restrict n, FILE *__restrict stream);
 /* 写一个字节到流 */
 int fputc(int c, FILE *stream);
 int putc(int c, FILE *stream);
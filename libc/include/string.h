@@ -38,9 +38,11 @@
 extern "C" {
 #endif /* __cplusplus */
 
+void *memchr(const void *, int, size_t);
 int memcmp(const void *, const void *, size_t);
 void *memcpy(void *__restrict, const void *__restrict, size_t);
 void *memmove(void *, const void *, size_t);
+void *memrchr(const void *, int, size_t);
 void *memset(void *, int, size_t);
 
 char *strchr(const char *, int);
@@ -53,9 +55,12 @@ char *strcpy(char *__restrict, const char *__restrict);
 int strcmp(const char *str1, const char *str2);
 size_t strcspn(const char *, const char *);
 int strncmp(const char *str1, const char *str2, size_t length);
+char *strpbrk(const char *, const char *);
 char *strrchr(const char *, int);
+char *strsep(char **__restrict, const char *__restrict);
 size_t strspn(const char *, const char *);
 char *strtok(char *__restrict, const char *__restrict);
+char *strtok_r(char *__restrict, const char *__restrict, char **__restrict);
 
 #ifdef __cplusplus
 }
@@ -23,7 +23,7 @@
 
 /**
  * lib/include/sys/mman.h
- * mmap munmap声明
+ * mmap munmap mremap声明
  */
 
 #ifndef SYS_MMAN_H
@@ -50,6 +50,11 @@ void *mmap(void *addr, size_t size, int protection, int flags, int fd, off_t off
  */
 int munmap(void *addr, size_t size);
 
+/**
+ * 将从oldAddress开始、长度为oldSize的区域改为newSize字节，flags包含MREMAP_MAYMOVE时允许移动到新的地址
+ */
+void *mremap(void *oldAddress, size_t oldSize, size_t newSize, int flags);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,49 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * lib/include/sys/ring.h
+ * 批量系统调用ring_enter声明
+ */
+
+#ifndef SYS_RING_H
+#define SYS_RING_H
+
+#include <inwox/ring.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 依次执行ring中最多count个已提交的系统调用并写入完成环，完成环满时提前停止，
+ * 整批只进入一次内核，返回执行的个数。exit、regfork、execve和ring_enter不能批量执行，
+ * 其完成项返回-1，错误码为ENOSYS。ring或其中的数组不完全在用户空间时返回-1，错误码为EFAULT
+ */
+int ring_enter(struct ring *ring, unsigned int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SYS_RING_H */
@@ -30,12 +30,12 @@
 #define TIME_H
 
 #define __need_clock_t
+#define __need_clockid_t
 #define __need_locale_t
 #define __need_NULL
 #define __need_size_t
 #define __need_time_t
 #if __USE_INWOX || __USE_POSIX
-#define __need_clockid_t
 #define __need_timer_t
 #endif
 #include <sys/types.h>
@@ -45,6 +45,13 @@
 extern "C" {
 #endif
 
+/* clock_gettime的时钟，CLOCK_REALTIME为距1970-01-01的时间，CLOCK_MONOTONIC为开机起的时间 */
+#define CLOCK_REALTIME  0
+#define CLOCK_MONOTONIC 1
+
+int clock_gettime(clockid_t, struct timespec *);
+time_t time(time_t *);
+
 #if __USE_INWOX || __USE_POSIX
 int nanosleep(const struct timespec *, struct timespec *);
 #endif
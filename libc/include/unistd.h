@@ -56,6 +56,7 @@ int close(int);
 int access(const char *, int);
 
 pid_t fork(void);
+pid_t getpid(void);
 pid_t rfork(int);
 char *getcwd(char *, size_t);
 int execl(const char *, const char *, ...);
@@ -26,6 +26,12 @@
  * 系统调用函数
  */
 
+.section .data
+# 实际进入内核的方式，第一次系统调用时由__syscallResolve根据CPUID选择
+.global __syscallEntry
+__syscallEntry:
+    .long __syscallResolve
+
 .section .text
 .global __syscall
 .type __syscall, @function
@@ -46,7 +52,7 @@ __syscall:
     mov 20(%ebp), %esi
     mov 24(%ebp), %edi
 
-    int $0x49
+    call *__syscallEntry
 
     # 错误码用ecx传递，如果不为0设置errno，如果为0，则errno使用内核默认设置的0
     test %ecx, %ecx
@@ -60,3 +66,56 @@ __syscall:
     pop %ebp
     ret
 .size __syscall, . - __syscall
+
+# 通过int 0x49进入内核，所有CPU都支持
+.type __syscallInt, @function
+__syscallInt:
+    int $0x49
+    ret
+.size __syscallInt, . - __syscallInt
+
+# 通过sysenter进入内核，%ebp给出用户栈，栈顶为返回地址，内核用%ebp返回错误码
+.type __syscallSysenter, @function
+__syscallSysenter:
+    push $1f
+    mov %esp, %ebp
+    sysenter
+1:  mov %ebp, %ecx
+    ret
+.size __syscallSysenter, . - __syscallSysenter
+
+# 检测CPU是否支持sysenter（与内核的判断相同），选定后直接跳转，此时系统调用参数已在寄存器中，需要保存
+.type __syscallResolve, @function
+__syscallResolve:
+    push %eax
+    push %ebx
+    push %ecx
+    push %edx
+
+    mov $1, %eax
+    cpuid
+    movl $__syscallInt, __syscallEntry
+    test $(1 << 11), %edx
+    jz 2f
+    # 早期的Pentium Pro报告了SEP但并不支持
+    mov %eax, %ecx
+    shr $8, %ecx
+    and $0xF, %ecx
+    cmp $6, %ecx
+    jne 1f
+    mov %eax, %ecx
+    shr $4, %ecx
+    and $0xF, %ecx
+    cmp $3, %ecx
+    jae 1f
+    and $0xF, %eax
+    cmp $3, %eax
+    jb 2f
+1:  movl $__syscallSysenter, __syscallEntry
+
+2:  pop %edx
+    pop %ecx
+    pop %ebx
+    pop %eax
+    jmp *__syscallEntry
+.size __syscallResolve, . - __syscallResolve
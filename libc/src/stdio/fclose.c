@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include "file.h"
 
 int fclose(FILE *file)
 {
@@ -37,6 +38,17 @@ int fclose(FILE *file)
     if (close(file->fd) == -1) {
         return EOF;
     }
+    if (file->prev) {
+        file->prev->next = file->next;
+    } else if (__firstFile == file) {
+        __firstFile = file->next;
+    }
+    if (file->next) {
+        file->next->prev = file->prev;
+    }
+    if ((file->flags & FILE_FLAG_BUFFERED) && !(file->flags & FILE_FLAG_USER_BUFFER)) {
+        free(file->buffer);
+    }
     free(file);
     return 0;
 }
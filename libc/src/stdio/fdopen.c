@@ -27,13 +27,21 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "file.h"
 
 FILE *fdopen(int fd, const char *mode)
 {
     (void)mode;
 
-    FILE *file = malloc(sizeof(FILE));
+    FILE *file = calloc(1, sizeof(FILE));
+    if (!file) {
+        return NULL;
+    }
     file->fd = fd;
-    file->flags = 0;
+    file->next = __firstFile;
+    if (__firstFile) {
+        __firstFile->prev = file;
+    }
+    __firstFile = file;
     return file;
 }
@@ -26,9 +26,16 @@
  */
 
 #include <stdio.h>
+#include "file.h"
 
+/**
+ * file为NULL时刷新所有流
+ */
 int fflush(FILE *file)
 {
-    (void)file;
-    return 0;
+    if (!file) {
+        __flushAllFiles();
+        return 0;
+    }
+    return __fileFlushWrite(file);
 }
@@ -26,19 +26,18 @@
  */
 
 #include <stdio.h>
-#include <unistd.h>
+#include "file.h"
 
 int fgetc(FILE *file)
 {
-if (file->flags & FILE_FLAG_EOF) return EOF;
-    unsigned char result;
-    ssize_t bytesRead = read(file->fd, &result, 1);
-    if (bytesRead == 0) {
-        file->flags |= FILE_FLAG_EOF;
+    if (file->readPosition < file->readEnd) {
+        return file->buffer[file->readPosition++];
+    }
+    if (file->flags & FILE_FLAG_EOF) {
         return EOF;
-    } else if (bytesRead < 0) {
-        file->flags |= FILE_FLAG_ERROR;
+    }
+    if (__fileFill(file) <= 0) {
         return EOF;
     }
-    return result;
+    return file->buffer[file->readPosition++];
 }
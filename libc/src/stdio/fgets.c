@@ -26,17 +26,32 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include "file.h"
 
 char *fgets(char *restrict buffer, int size, FILE *restrict file)
 {
-    int i = 0;
-    while (i < size - 1) {
-        int c = fgetc(file);
-        if (c == EOF) {
-            break;
+    size_t i = 0;
+    while (i + 1 < (size_t)size) {
+        if (file->readPosition == file->readEnd) {
+            if ((file->flags & FILE_FLAG_EOF) || __fileFill(file) <= 0) {
+                break;
+            }
+        }
+        /* 在读缓冲中查找换行，找到后连同换行一起复制 */
+        const unsigned char *start = file->buffer + file->readPosition;
+        size_t length = file->readEnd - file->readPosition;
+        if (length > size - 1 - i) {
+            length = size - 1 - i;
+        }
+        const unsigned char *newline = memchr(start, '\n', length);
+        if (newline) {
+            length = newline - start + 1;
         }
-        buffer[i++] = c;
-        if (c == '\n') {
+        memcpy(buffer + i, start, length);
+        file->readPosition += length;
+        i += length;
+        if (newline) {
             break;
         }
     }
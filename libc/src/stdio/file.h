@@ -0,0 +1,49 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * libc/src/stdio/file.h
+ * 流缓冲的内部接口
+ */
+#ifndef STDIO_FILE_H
+#define STDIO_FILE_H
+
+#include <stdio.h>
+
+/* fdopen打开的流组成的链表 */
+extern FILE *__firstFile;
+
+/* 第一次读写或setvbuf之前确定流的缓冲方式并分配缓冲区 */
+void __fileSetupBuffer(FILE *file);
+/* 将写缓冲写出，成功返回0，失败返回EOF */
+int __fileFlushWrite(FILE *file);
+/* 读缓冲为空时从文件读入，返回读到的字节数，文件结束返回0，出错返回-1 */
+ssize_t __fileFill(FILE *file);
+/* 不经过缓冲直接读入data，用于大块读取，返回值同__fileFill */
+ssize_t __fileReadDirect(FILE *file, void *data, size_t size);
+/* 经缓冲写入size个字节，返回写入的字节数 */
+size_t __fileWrite(FILE *file, const void *data, size_t size);
+/* 刷新所有流，exit时调用 */
+void __flushAllFiles(void);
+
+#endif /* STDIO_FILE_H */
@@ -0,0 +1,167 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* libc/src/stdio/filebuffer.c
+ * 流缓冲：普通文件全缓冲，终端行缓冲，stderr无缓冲
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "file.h"
+
+FILE *__firstFile = NULL;
+
+void __fileSetupBuffer(FILE *file)
+{
+    if (file->flags & FILE_FLAG_BUFFERED) {
+        return;
+    }
+    file->flags |= FILE_FLAG_BUFFERED;
+    // 判断终端和分配缓冲失败都不影响这次读写成功，不能留下ENOTTY或ENOMEM
+    int savedErrno = errno;
+    struct termios termios;
+    file->bufferMode = tcgetattr(file->fd, &termios) == 0 ? _IOLBF : _IOFBF;
+    file->buffer = malloc(BUFSIZ);
+    file->bufferSize = BUFSIZ;
+    if (!file->buffer) {
+        file->bufferMode = _IONBF;
+    }
+    if (file->bufferMode == _IONBF) {
+        file->buffer = &file->singleByte;
+        file->bufferSize = 1;
+        file->flags |= FILE_FLAG_USER_BUFFER;
+    }
+    errno = savedErrno;
+}
+
+/**
+ * 写出全部数据，write只写出一部分时继续写
+ */
+static int writeAll(FILE *file, const unsigned char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = write(file->fd, data, size);
+        if (written <= 0) {
+            file->flags |= FILE_FLAG_ERROR;
+            return EOF;
+        }
+        data += written;
+        size -= written;
+    }
+    return 0;
+}
+
+int __fileFlushWrite(FILE *file)
+{
+    if (file->writePosition == 0) {
+        return 0;
+    }
+    int result = writeAll(file, file->buffer, file->writePosition);
+    file->writePosition = 0;
+    return result;
+}
+
+/**
+ * 从终端等交互设备读取前先把行缓冲的输出写出，否则不以换行结尾的提示符不会显示
+ */
+static void flushLineBufferedFiles(void)
+{
+    if (stdout->bufferMode == _IOLBF) {
+        __fileFlushWrite(stdout);
+    }
+    for (FILE *file = __firstFile; file; file = file->next) {
+        if (file->bufferMode == _IOLBF) {
+            __fileFlushWrite(file);
+        }
+    }
+}
+
+ssize_t __fileReadDirect(FILE *file, void *data, size_t size)
+{
+    __fileSetupBuffer(file);
+    if (__fileFlushWrite(file) == EOF) {
+        return -1;
+    }
+    if (file->bufferMode != _IOFBF) {
+        flushLineBufferedFiles();
+    }
+    ssize_t bytesRead = read(file->fd, data, size);
+    if (bytesRead == 0) {
+        file->flags |= FILE_FLAG_EOF;
+    } else if (bytesRead < 0) {
+        file->flags |= FILE_FLAG_ERROR;
+        bytesRead = -1;
+    }
+    return bytesRead;
+}
+
+ssize_t __fileFill(FILE *file)
+{
+    __fileSetupBuffer(file);
+    ssize_t bytesRead = __fileReadDirect(file, file->buffer, file->bufferSize);
+    file->readPosition = 0;
+    file->readEnd = bytesRead > 0 ? bytesRead : 0;
+    return bytesRead;
+}
+
+size_t __fileWrite(FILE *file, const void *data, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)data;
+
+    __fileSetupBuffer(file);
+    /* 没有lseek无法回退已读入但未使用的数据，转为写入时直接丢弃 */
+    file->readPosition = file->readEnd = 0;
+
+    if (file->bufferMode == _IONBF) {
+        return writeAll(file, p, size) == EOF ? 0 : size;
+    }
+    if (file->writePosition + size > file->bufferSize) {
+        if (__fileFlushWrite(file) == EOF) {
+            return 0;
+        }
+        /* 放不进缓冲区的数据直接写出，避免多一次复制 */
+        if (size >= file->bufferSize) {
+            return writeAll(file, p, size) == EOF ? 0 : size;
+        }
+    }
+    memcpy(file->buffer + file->writePosition, p, size);
+    file->writePosition += size;
+    if (file->bufferMode == _IOLBF && memchr(p, '\n', size)) {
+        if (__fileFlushWrite(file) == EOF) {
+            return 0;
+        }
+    }
+    return size;
+}
+
+void __flushAllFiles(void)
+{
+    __fileFlushWrite(stdout);
+    __fileFlushWrite(stderr);
+    for (FILE *file = __firstFile; file; file = file->next) {
+        __fileFlushWrite(file);
+    }
+}
@@ -26,13 +26,20 @@
  */
 
 #include <stdio.h>
-#include <unistd.h>
+#include "file.h"
 
 int fputc(int c, FILE *file)
 {
-    if (write(file->fd, &c, 1) < 0) {
-        file->flags |= FILE_FLAG_ERROR;
+    unsigned char ch = (unsigned char)c;
+
+    /* 缓冲区有空间时直接放入，不经过__fileWrite */
+    if (file->bufferMode != _IONBF && file->readEnd == 0 &&
+        file->writePosition < file->bufferSize && (ch != '\n' || file->bufferMode == _IOFBF)) {
+        file->buffer[file->writePosition++] = ch;
+        return ch;
+    }
+    if (__fileWrite(file, &ch, 1) != 1) {
         return EOF;
     }
-    return c;
+    return ch;
 }
@@ -26,14 +26,14 @@
  */
 
 #include <stdio.h>
-#include <unistd.h>
+#include <string.h>
+#include "file.h"
 
 int fputs(const char *restrict s, FILE *restrict file)
 {
-    while (*s) {
-        if (write(file->fd, s++, 1) < 0) {
-            return EOF;
-        }
+    size_t length = strlen(s);
+    if (__fileWrite(file, s, length) != length) {
+        return EOF;
     }
     return 1;
 }
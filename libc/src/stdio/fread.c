@@ -0,0 +1,69 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* libc/src/stdio/fread.c
+ * 从流file读取count个大小为size的数据项到ptr
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "file.h"
+
+size_t fread(void *restrict ptr, size_t size, size_t count, FILE *restrict file)
+{
+    if (size == 0 || count == 0) {
+        return 0;
+    }
+    unsigned char *p = (unsigned char *)ptr;
+    size_t total = size * count;
+    size_t done = 0;
+
+    while (done < total) {
+        size_t available = file->readEnd - file->readPosition;
+        if (available > 0) {
+            size_t length = available < total - done ? available : total - done;
+            memcpy(p + done, file->buffer + file->readPosition, length);
+            file->readPosition += length;
+            done += length;
+            continue;
+        }
+        if (file->flags & FILE_FLAG_EOF) {
+            break;
+        }
+        __fileSetupBuffer(file);
+        ssize_t bytesRead;
+        /* 剩余数据不少于缓冲区大小时直接读入目标，省去一次复制 */
+        if (total - done >= file->bufferSize) {
+            bytesRead = __fileReadDirect(file, p + done, total - done);
+            if (bytesRead > 0) {
+                done += bytesRead;
+            }
+        } else {
+            bytesRead = __fileFill(file);
+        }
+        if (bytesRead <= 0) {
+            break;
+        }
+    }
+    return done / size;
+}
@@ -26,22 +26,12 @@
  */
 
 #include <stdio.h>
+#include "file.h"
 
 size_t fwrite(const void *restrict ptr, size_t size, size_t count, FILE *restrict file)
 {
-    const unsigned char *p = (const unsigned char *)ptr;
-
     if (size == 0 || count == 0) {
         return 0;
     }
-
-    size_t i;
-    for (i = 0; i < count; i++) {
-        for (size_t j = 0; j < size; j++) {
-            if (fputc(p[i * size + j], file) == EOF) {
-                return i;
-            }
-        }
-    }
-    return i;
+    return __fileWrite(file, ptr, size * count) / size;
 }
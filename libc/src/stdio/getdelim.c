@@ -0,0 +1,84 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* libc/src/stdio/getdelim.c
+ * 读取到分隔符delimiter为止的数据，*lineptr的空间不够时使用realloc扩大
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "file.h"
+
+ssize_t getdelim(char **restrict lineptr, size_t *restrict n, int delimiter, FILE *restrict file)
+{
+    if (!lineptr || !n) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!*lineptr) {
+        *n = 0;
+    }
+
+    size_t i = 0;
+    while (1) {
+        if (file->readPosition == file->readEnd) {
+            if ((file->flags & FILE_FLAG_EOF) || __fileFill(file) <= 0) {
+                break;
+            }
+        }
+        const unsigned char *start = file->buffer + file->readPosition;
+        size_t length = file->readEnd - file->readPosition;
+        const unsigned char *end = memchr(start, delimiter, length);
+        if (end) {
+            length = end - start + 1;
+        }
+        /* 为末尾的'\0'保留一个字节，空间按倍数扩大 */
+        if (i + length + 1 > *n) {
+            size_t newSize = *n ? *n : 128;
+            while (newSize < i + length + 1) {
+                newSize *= 2;
+            }
+            char *newLine = realloc(*lineptr, newSize);
+            if (!newLine) {
+                file->flags |= FILE_FLAG_ERROR;
+                errno = ENOMEM;
+                return -1;
+            }
+            *lineptr = newLine;
+            *n = newSize;
+        }
+        memcpy(*lineptr + i, start, length);
+        file->readPosition += length;
+        i += length;
+        if (end) {
+            break;
+        }
+    }
+    if (i == 0) {
+        return -1;
+    }
+    (*lineptr)[i] = '\0';
+    return i;
+}
@@ -29,9 +29,8 @@
 
 int puts(const char *s)
 {
-    while (*s) {
-        putchar(*s++);
+    if (fputs(s, stdout) == EOF || putchar('\n') == EOF) {
+        return EOF;
     }
-    putchar('\n');
     return 1;
 }
@@ -0,0 +1,72 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* libc/src/stdio/setvbuf.c
+ * 设置流的缓冲方式和缓冲区
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "file.h"
+
+int setvbuf(FILE *restrict file, char *restrict buffer, int mode, size_t size)
+{
+    if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (__fileFlushWrite(file) == EOF) {
+        return -1;
+    }
+
+    unsigned char *newBuffer = (unsigned char *)buffer;
+    int userBuffer = 1;
+    if (mode == _IONBF) {
+        newBuffer = &file->singleByte;
+        size = 1;
+    } else if (!newBuffer || size == 0) {
+        if (size == 0) {
+            size = BUFSIZ;
+        }
+        newBuffer = malloc(size);
+        if (!newBuffer) {
+            return -1;
+        }
+        userBuffer = 0;
+    }
+
+    if ((file->flags & FILE_FLAG_BUFFERED) && !(file->flags & FILE_FLAG_USER_BUFFER)) {
+        free(file->buffer);
+    }
+    file->flags |= FILE_FLAG_BUFFERED;
+    file->flags &= ~FILE_FLAG_USER_BUFFER;
+    if (userBuffer) {
+        file->flags |= FILE_FLAG_USER_BUFFER;
+    }
+    file->bufferMode = mode;
+    file->buffer = newBuffer;
+    file->bufferSize = size;
+    file->readPosition = file->readEnd = 0;
+    return 0;
+}
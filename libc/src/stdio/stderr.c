@@ -27,9 +27,13 @@
 
 #include <stdio.h>
 
+/* stderr不缓冲，错误信息立即输出 */
 static FILE __stderr = {
     .fd = 2,
-    .flags = 0,
+    .flags = FILE_FLAG_BUFFERED | FILE_FLAG_USER_BUFFER,
+    .bufferMode = _IONBF,
+    .buffer = &__stderr.singleByte,
+    .bufferSize = 1,
 };
 
 FILE *stderr = &__stderr;
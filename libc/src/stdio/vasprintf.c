@@ -0,0 +1,83 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* libc/src/stdio/vasprintf.c
+ * 使用可变参数格式化输出到新分配的内存，由调用者free
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct heapBuffer {
+    char *buffer;
+    size_t used;
+    size_t size;
+};
+
+/**
+ * 空间不足时按倍数扩大，只格式化一遍，%n指向的变量也只写一次
+ */
+static size_t vasprintf_callback(void *arg, const char *s, size_t length)
+{
+    struct heapBuffer *heap = arg;
+    if (heap->used + length + 1 > heap->size) {
+        size_t newSize = heap->size * 2;
+        while (newSize < heap->used + length + 1) {
+            newSize *= 2;
+        }
+        char *newBuffer = realloc(heap->buffer, newSize);
+        if (!newBuffer) {
+            return 0;
+        }
+        heap->buffer = newBuffer;
+        heap->size = newSize;
+    }
+    memcpy(heap->buffer + heap->used, s, length);
+    heap->used += length;
+    return length;
+}
+
+int vasprintf(char **restrict result, const char *restrict format, va_list vl)
+{
+    struct heapBuffer heap;
+    heap.used = 0;
+    heap.size = 64;
+    heap.buffer = malloc(heap.size);
+    *result = NULL;
+    if (!heap.buffer) {
+        return -1;
+    }
+
+    int length = vcbprintf(&heap, vasprintf_callback, format, vl);
+    if (length < 0) {
+        free(heap.buffer);
+        return -1;
+    }
+    heap.buffer[heap.used] = '\0';
+    /* 归还多余的空间 */
+    char *shrunk = realloc(heap.buffer, heap.used + 1);
+    *result = shrunk ? shrunk : heap.buffer;
+    return length;
+}
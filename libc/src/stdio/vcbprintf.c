@@ -75,24 +75,125 @@ static size_t noop_callback(void *param, const char *s, size_t length)
     return length;
 }
 
-static size_t convert_integer(char *destination, uintmax_t value, uintmax_t base, const char *digits)
+/**
+ * 输出先积累在栈上的缓冲区中，满了或格式化结束时才调用一次callback，
+ * 连续的普通字符和填充字符不再每个字符调用一次
+ */
+#define OUTPUT_BUFFER_SIZE 128
+
+struct output {
+    void *param;
+    size_t (*callback)(void *, const char *, size_t);
+    size_t used;
+    char buffer[OUTPUT_BUFFER_SIZE];
+};
+
+static bool flushOutput(struct output *out)
+{
+    size_t used = out->used;
+    out->used = 0;
+    return used == 0 || out->callback(out->param, out->buffer, used) == used;
+}
+
+static bool writeOutput(struct output *out, const char *s, size_t length)
 {
-    uintmax_t i = value;
-    int length = 0;
-    while (i > 0) {
-        i /= base;
-        length++;
+    if (length > OUTPUT_BUFFER_SIZE - out->used) {
+        if (!flushOutput(out)) {
+            return false;
+        }
+        /* 缓冲区放不下的长字符串直接交给callback */
+        if (length >= OUTPUT_BUFFER_SIZE) {
+            return out->callback(out->param, s, length) == length;
+        }
     }
-    destination += length;
-    do {
-        *--destination = digits[value % base];
-        value /= base;
-    } while (value);
-    return length;
+    memcpy(out->buffer + out->used, s, length);
+    out->used += length;
+    return true;
+}
+
+static bool padOutput(struct output *out, char c, int count)
+{
+    while (count > 0) {
+        if (out->used == OUTPUT_BUFFER_SIZE && !flushOutput(out)) {
+            return false;
+        }
+        size_t length = OUTPUT_BUFFER_SIZE - out->used;
+        if (length > (size_t)count) {
+            length = count;
+        }
+        memset(out->buffer + out->used, c, length);
+        out->used += length;
+        count -= length;
+    }
+    return true;
+}
+
+/* 00到99的两位十进制数字，每次除以100得到两位 */
+static const char decimalPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static char *convert_decimal32(char *end, uint32_t value)
+{
+    while (value >= 100) {
+        uint32_t pair = value % 100;
+        value /= 100;
+        end -= 2;
+        memcpy(end, &decimalPairs[pair * 2], 2);
+    }
+    if (value >= 10) {
+        end -= 2;
+        memcpy(end, &decimalPairs[value * 2], 2);
+    } else if (value > 0) {
+        *--end = '0' + value;
+    }
+    return end;
 }
 
-static int printInteger(void *param, size_t (*callback)(void *, const char *, size_t), char specifier, uintmax_t value,
-                        int fieldWidth, int precision, int flags)
+/**
+ * 将value转换为字符串，从end向前写入，返回第一个数字的位置，value为0时不输出数字
+ *
+ * 十进制64位除法在i686上需要调用libgcc，先按10^9分段，64位除法只在value超过UINT32_MAX时进行，
+ * 最多两次，其余各段都用32位运算；八进制和十六进制只需移位和掩码
+ */
+static char *convert_integer(char *end, uintmax_t value, unsigned int base, const char *digits)
+{
+    if (base == 16) {
+        while (value) {
+            *--end = digits[value & 0xF];
+            value >>= 4;
+        }
+        return end;
+    }
+    if (base == 8) {
+        while (value) {
+            *--end = digits[value & 7];
+            value >>= 3;
+        }
+        return end;
+    }
+    while (value > UINT32_MAX) {
+        uint32_t low = value % 1000000000;
+        value /= 1000000000;
+        char *start = convert_decimal32(end, low);
+        /* 中间的段需要补足9位 */
+        while (start > end - 9) {
+            *--start = '0';
+        }
+        end = start;
+    }
+    return convert_decimal32(end, (uint32_t)value);
+}
+
+static int printInteger(struct output *out, char specifier, uintmax_t value, int fieldWidth, int precision, int flags)
 {
     bool negative = false;
     if (specifier == 'd' || specifier == 'i') {
@@ -115,7 +216,9 @@ static int printInteger(void *param, size_t (*callback)(void *, const char *, si
         base = 16;
     }
 
-    int stringLength = convert_integer(buffer, value, base, digits);
+    char *bufferEnd = buffer + sizeof(buffer);
+    const char *string = convert_integer(bufferEnd, value, base, digits);
+    int stringLength = bufferEnd - string;
 
     if (flags & FLAG_ALTERNATIVE && specifier == 'o' && stringLength >= precision) {
         if (__builtin_add_overflow(stringLength, 1, &precision)) {
@@ -139,70 +242,57 @@ static int printInteger(void *param, size_t (*callback)(void *, const char *, si
     }
 
     if (!(flags & (FLAG_LEFT_JUSTIFIED | FLAG_LEADING_ZEROS))) {
-        for (int i = unpaddedLength; i < fieldWidth; i++) {
-            if (callback(param, " ", 1) != 1)
-                return -1;
-        }
+        if (!padOutput(out, ' ', fieldWidth - unpaddedLength))
+            return -1;
     }
 
     if (negative || flags & (FLAG_PLUS | FLAG_SPACE)) {
         char sign = negative ? '-' : (flags & FLAG_PLUS) ? '+' : ' ';
-        if (callback(param, &sign, 1) != 1)
+        if (!writeOutput(out, &sign, 1))
             return -1;
     }
 
     if (flags & FLAG_ALTERNATIVE) {
         if (specifier == 'x' && value != 0) {
-            if (callback(param, "0x", 2) != 2)
+            if (!writeOutput(out, "0x", 2))
                 return -1;
         } else if (specifier == 'X' && value != 0) {
-            if (callback(param, "0X", 2) != 2)
+            if (!writeOutput(out, "0X", 2))
                 return -1;
         }
     }
 
     if (!(flags & FLAG_LEFT_JUSTIFIED) && flags & FLAG_LEADING_ZEROS) {
-        for (int i = unpaddedLength; i < fieldWidth; i++) {
-            if (callback(param, "0", 1) != 1)
-                return -1;
-        }
-    }
-
-    for (int i = stringLength; i < precision; i++) {
-        if (callback(param, "0", 1) != 1)
+        if (!padOutput(out, '0', fieldWidth - unpaddedLength))
             return -1;
     }
 
-    if (callback(param, buffer, stringLength) != (size_t)stringLength) {
+    if (!padOutput(out, '0', precision - stringLength))
+        return -1;
+
+    if (!writeOutput(out, string, stringLength)) {
         return -1;
     }
 
     if (flags & FLAG_LEFT_JUSTIFIED) {
-        for (int i = unpaddedLength; i < fieldWidth; i++) {
-            if (callback(param, " ", 1) != 1)
-                return -1;
-        }
+        if (!padOutput(out, ' ', fieldWidth - unpaddedLength))
+            return -1;
     }
 
     return unpaddedLength >= fieldWidth ? unpaddedLength : fieldWidth;
 }
 
-static int printString(void *param, size_t (*callback)(void *, const char *, size_t), const char *s, int length,
-                       int fieldWidth, int flags)
+static int printString(struct output *out, const char *s, int length, int fieldWidth, int flags)
 {
     if (!(flags & FLAG_LEFT_JUSTIFIED)) {
-        for (int i = length; i < fieldWidth; i++) {
-            if (callback(param, " ", 1) != 1)
-                return -1;
-        }
+        if (!padOutput(out, ' ', fieldWidth - length))
+            return -1;
     }
-    if (callback(param, s, length) != (size_t)length)
+    if (!writeOutput(out, s, length))
         return -1;
     if (flags & FLAG_LEFT_JUSTIFIED) {
-        for (int i = length; i < fieldWidth; i++) {
-            if (callback(param, " ", 1) != 1)
-                return -1;
-        }
+        if (!padOutput(out, ' ', fieldWidth - length))
+            return -1;
     }
 
     return length >= fieldWidth ? length : fieldWidth;
@@ -213,6 +303,10 @@ int vcbprintf(void *param, size_t (*callback)(void *, const char *, size_t), con
     if (!callback) {
         callback = noop_callback;
     }
+    struct output out;
+    out.param = param;
+    out.callback = callback;
+    out.used = 0;
 
     bool invalidConversion = false;
     int result = 0;
@@ -222,10 +316,17 @@ int vcbprintf(void *param, size_t (*callback)(void *, const char *, size_t), con
 
     while (*format) {
         if (*format != '%' || invalidConversion) {
-            if (callback(param, format, 1) != 1) {
+            /* 一次输出到下一个'%'之前的全部普通字符 */
+            size_t literalLength = invalidConversion ? strlen(format) : strcspn(format, "%");
+            if (literalLength > INT_MAX) {
+                goto overflow;
+            }
+            if (!writeOutput(&out, format, literalLength)) {
                 return -1;
             }
-            INCREMENT_RESULT(1);
+            INCREMENT_RESULT((int)literalLength);
+            format += literalLength;
+            continue;
         } else {
             const char *specifierBegin = format;
 
@@ -401,7 +502,7 @@ int vcbprintf(void *param, size_t (*callback)(void *, const char *, size_t), con
                         flags &= ~FLAG_LEADING_ZEROS;
                     }
 
-                    written = printInteger(param, callback, specifier, value, fieldWidth, precision, flags);
+                    written = printInteger(&out, specifier, value, fieldWidth, precision, flags);
                     if (written < 0) {
                         return -1;
                     }
@@ -409,7 +510,7 @@ int vcbprintf(void *param, size_t (*callback)(void *, const char *, size_t), con
                     break;
                 case 'c':
                     c = (char)va_arg(vl, int);
-                    written = printString(param, callback, &c, 1, fieldWidth, flags);
+                    written = printString(&out, &c, 1, fieldWidth, flags);
                     if (written < 0) {
                         return -1;
                     }
@@ -427,7 +528,7 @@ int vcbprintf(void *param, size_t (*callback)(void *, const char *, size_t), con
                         goto overflow;
                     }
 
-                    written = printString(param, callback, s, (int)size, fieldWidth, flags);
+                    written = printString(&out, s, (int)size, fieldWidth, flags);
                     if (written < 0) {
                         return -1;
                     }
@@ -435,7 +536,7 @@ int vcbprintf(void *param, size_t (*callback)(void *, const char *, size_t), con
                     break;
                 case 'p':
                     value = (uintptr_t)va_arg(vl, void *);
-                    written = printInteger(param, callback, 'x', value, 0, 1, FLAG_ALTERNATIVE);
+                    written = printInteger(&out, 'x', value, 0, 1, FLAG_ALTERNATIVE);
                     if (written < 0) {
                         return -1;
                     }
@@ -445,7 +546,7 @@ int vcbprintf(void *param, size_t (*callback)(void *, const char *, size_t), con
                     *va_arg(vl, int *) = result;
                     break;
                 case '%':
-                    if (callback(param, "%", 1) != 1) {
+                    if (!writeOutput(&out, "%", 1)) {
                         return -1;
                     }
                     INCREMENT_RESULT(1);
@@ -459,6 +560,9 @@ int vcbprintf(void *param, size_t (*callback)(void *, const char *, size_t), con
         format++;
     }
 
+    if (!flushOutput(&out)) {
+        return -1;
+    }
     return result;
 
 overflow:
@@ -0,0 +1,60 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* libc/src/stdio/vsnprintf.c
+ * 使用可变参数格式化输出到长度为size的buffer，超出部分截断
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+struct buffer {
+    char *position;
+    /* 还能写入的字节数，已为结尾的'\0'保留一个字节 */
+    size_t remaining;
+};
+
+static size_t vsnprintf_callback(void *arg, const char *s, size_t length)
+{
+    struct buffer *buffer = arg;
+    size_t copyLength = length < buffer->remaining ? length : buffer->remaining;
+    memcpy(buffer->position, s, copyLength);
+    buffer->position += copyLength;
+    buffer->remaining -= copyLength;
+    /* 截断的部分也计入返回值，调用者据此得知需要的长度 */
+    return length;
+}
+
+int vsnprintf(char *restrict s, size_t size, const char *restrict format, va_list vl)
+{
+    struct buffer buffer;
+    buffer.position = s;
+    buffer.remaining = size ? size - 1 : 0;
+
+    int result = vcbprintf(&buffer, size ? vsnprintf_callback : NULL, format, vl);
+    if (size) {
+        *buffer.position = '\0';
+    }
+    return result;
+}
@@ -29,11 +29,13 @@
 #include <stdlib.h>
 
 __attribute__((weak)) void __callAtexitHandlers(void) {}
+__attribute__((weak)) void __flushAllFiles(void) {}
 extern void _fini(void);
 
 __attribute__((__noreturn__)) void exit(int status)
 {
     __callAtexitHandlers();
+    __flushAllFiles();
     _fini();
     _Exit(status);
 }
@@ -26,28 +26,33 @@
  * 实现libc中free函数
  */
 
+#include <assert.h>
 #include "malloc.h"
 
-void free(void *addr)
+/**
+ * 将块归还给堆，与前后的空闲块合并，需持有__lockHeap
+ */
+void __releaseBlock(Mem_Ctrl_Blk *block)
 {
-    if (addr == NULL) {
-        return;
-    }
-    __lockHeap();
-
-    Mem_Ctrl_Blk *block = (Mem_Ctrl_Blk *)addr - 1;
+    assert(block->magic == MAGIC_USED_MCB);
     block->magic = MAGIC_FREE_MCB;
 
-    /* 如果释放的内存可以和前后合并，则合并 */
+    /* 如果释放的内存可以和前后合并，则合并，被合并的空闲块先从空闲链表中移除 */
     if (block->prev && block->prev->magic == MAGIC_FREE_MCB) {
+        __removeFreeBlock(block->prev);
         block = __unifyBlocks(block->prev, block);
     }
     if (block->next->magic == MAGIC_FREE_MCB) {
+        __removeFreeBlock(block->next);
         block = __unifyBlocks(block, block->next);
     }
-    /* 如果是凑够了一整个大的Block，则返回给OS */
-    if (block->prev == NULL && block->next->magic == MAGIC_END_MCB) {
-        Mem_Ctrl_Blk *bigBlock = block - 1;
+    /**
+     * 如果是凑够了一整个大的Block，则返回给OS，否则放入空闲链表
+     * 保留的整个空闲Block总大小不超过trim阈值时先不归还，避免频繁申请释放时反复映射
+     */
+    Mem_Ctrl_Blk *bigBlock = block - 1;
+    int wholeBigBlock = block->prev == NULL && block->next->magic == MAGIC_END_MCB;
+    if (wholeBigBlock && __retainedArenaSize + bigBlock->size > __trimThreshold) {
         if (bigBlock->prev) {
             bigBlock->prev->next = bigBlock->next;
         }
@@ -55,6 +60,34 @@ void free(void *addr)
             bigBlock->next->prev = bigBlock->prev;
         }
         unmapMemory(bigBlock, bigBlock->size);
+    } else {
+        if (wholeBigBlock) {
+            __retainedArenaSize += bigBlock->size;
+        }
+        __insertFreeBlock(block);
     }
+}
+
+void free(void *addr)
+{
+    if (addr == NULL) {
+        return;
+    }
+    Mem_Ctrl_Blk *block = (Mem_Ctrl_Blk *)addr - 1;
+    if (block->magic == MAGIC_MAPPED_MCB) {
+        size_t mapSize = block->size + sizeof(Mem_Ctrl_Blk);
+        __atomic_sub_fetch(&__mappedBlockCount, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&__mappedBlockBytes, mapSize, __ATOMIC_RELAXED);
+        unmapMemory(block, mapSize);
+        return;
+    }
+    assert(block->magic == MAGIC_USED_MCB);
+    /* 小块放入缓存，不需要获取堆锁 */
+    if (block->size <= SMALL_CLASS_MAX) {
+        __cacheBlock(block);
+        return;
+    }
+    __lockHeap();
+    __releaseBlock(block);
     __unlockHeap();
 }
@@ -0,0 +1,127 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 - 2021 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * libc/src/stdlib/mallinfo.c
+ * 内存分配器的统计信息和分配采样结果
+ */
+
+#include <malloc.h>
+#include <string.h>
+#include "malloc.h"
+
+#ifdef __is_inwox_libc
+#include <stdarg.h>
+#include <stdio.h>
+
+void __mallocPrintf(const char *format, ...)
+{
+    va_list vl;
+    va_start(vl, format);
+    vdprintf(2, format, vl);
+    va_end(vl);
+}
+#endif
+
+static unsigned int histogramIndex(size_t size)
+{
+    unsigned int index = 0;
+    size /= 32;
+    while (size && index < MALLINFO_HISTOGRAM_SIZE - 1) {
+        size >>= 1;
+        index++;
+    }
+    return index;
+}
+
+/**
+ * 遍历所有Big_MCB统计堆的使用情况
+ * 缓存中的块只在__lockCache保护下改变状态，遍历时同时持有两把锁，顺序与flushCache相同
+ */
+struct mallinfo mallinfo(void)
+{
+    struct mallinfo info;
+    memset(&info, 0, sizeof(info));
+
+    __lockHeap();
+    unsigned long state = __lockCache();
+    for (Mem_Ctrl_Blk *bigBlock = firstBigBlock->next; bigBlock; bigBlock = bigBlock->next) {
+        info.arena += bigBlock->size;
+        info.bigblks++;
+        for (Mem_Ctrl_Blk *block = bigBlock + 1; block->magic != MAGIC_END_MCB; block = block->next) {
+            if (block->magic == MAGIC_FREE_MCB) {
+                info.ordblks++;
+                info.fordblks += block->size;
+                info.histogram[histogramIndex(block->size)]++;
+            } else if (block->magic == MAGIC_CACHED_MCB) {
+                info.cached += block->size;
+            } else {
+                info.uordblks += block->size;
+            }
+        }
+    }
+    info.keepcost = __retainedArenaSize;
+    __unlockCache(state);
+    __unlockHeap();
+
+    info.hblks = __atomic_load_n(&__mappedBlockCount, __ATOMIC_RELAXED);
+    info.hblkhd = __atomic_load_n(&__mappedBlockBytes, __ATOMIC_RELAXED);
+    return info;
+}
+
+void malloc_stats(void)
+{
+    struct mallinfo info = mallinfo();
+    __mallocPrintf("arena:   %zu bytes in %zu big blocks\n", info.arena, info.bigblks);
+    __mallocPrintf("in use:  %zu bytes\n", info.uordblks);
+    __mallocPrintf("free:    %zu bytes in %zu blocks\n", info.fordblks, info.ordblks);
+    __mallocPrintf("cached:  %zu bytes\n", info.cached);
+    __mallocPrintf("kept:    %zu bytes\n", info.keepcost);
+    __mallocPrintf("mmapped: %zu bytes in %zu blocks\n", info.hblkhd, info.hblks);
+    for (unsigned int i = 0; i < MALLINFO_HISTOGRAM_SIZE; i++) {
+        if (info.histogram[i]) {
+            __mallocPrintf("free blocks >= %zu: %zu\n", (size_t)16 << i, info.histogram[i]);
+        }
+    }
+}
+
+/**
+ * 输出分配采样结果，每个调用者一行：返回地址、采样次数和采样到的字节数
+ */
+void malloc_profile_dump(void)
+{
+    Profile_Sample samples[PROFILE_MAX];
+    unsigned long state = __lockCache();
+    memcpy(samples, __profileSamples, sizeof(samples));
+    size_t dropped = __profileDropped;
+    size_t interval = __profileInterval;
+    __unlockCache(state);
+
+    __mallocPrintf("malloc profile: 1 in %zu allocations\n", interval);
+    for (size_t i = 0; i < PROFILE_MAX && samples[i].caller; i++) {
+        __mallocPrintf("%p: %zu samples, %zu bytes\n", samples[i].caller, samples[i].count, samples[i].bytes);
+    }
+    if (dropped) {
+        __mallocPrintf("%zu samples dropped\n", dropped);
+    }
+}
@@ -30,6 +30,7 @@
 #include <errno.h>
 #include <stdalign.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "malloc.h"
 
 #ifdef __is_inwox_libc
@@ -40,6 +41,14 @@ void __lockHeap(void) {
 void __unlockHeap(void) {
 
 }
+
+unsigned long __lockCache(void) {
+    return 0;
+}
+
+void __unlockCache(unsigned long state) {
+    (void)state;
+}
 #endif
 
 /**
@@ -56,9 +65,26 @@ static Mem_Ctrl_Blk emptyBigBlock[2] = {{MAGIC_BIG_MCB, sizeof(emptyBigBlock), N
 /* firstBigBlock指向最开始的空内存控制块，每次分配内存都从这里开始 */
 Mem_Ctrl_Blk *firstBigBlock = emptyBigBlock;
 
+/* mallopt可以调整的参数 */
+size_t __mmapThreshold = MMAP_THRESHOLD_DEFAULT;
+size_t __trimThreshold = TRIM_THRESHOLD_DEFAULT;
+/* 整个空闲但未归还给系统的Big_MCB总大小 */
+size_t __retainedArenaSize = 0;
+/* 下一次申请Big_MCB的大小 */
+static size_t arenaSize = ARENA_MIN_SIZE;
+/* 单独映射的块的统计 */
+size_t __mappedBlockCount = 0;
+size_t __mappedBlockBytes = 0;
+/* 分配采样，__profileInterval为0时不采样 */
+size_t __profileInterval = 0;
+Profile_Sample __profileSamples[PROFILE_MAX];
+/* 调用者太多，记录不下的采样次数 */
+size_t __profileDropped = 0;
+static size_t profileCountdown = 0;
+
 /**
  * 申请一个大内存控制块，并将其链在上一个大内存控制块之后
- * 申请时按页对齐
+ * 申请时按页对齐，大小至少为arenaSize，每申请一次arenaSize加倍，直到ARENA_MAX_SIZE
  */
 Mem_Ctrl_Blk *__allocateBigBlock(Mem_Ctrl_Blk *lastBigBlock, size_t size)
 {
@@ -68,13 +94,17 @@ Mem_Ctrl_Blk *__allocateBigBlock(Mem_Ctrl_Blk *lastBigBlock, size_t size)
     /* 因为是按页申请，所以页对齐 */
     size = ALIGN_UP(size, PAGESIZE);
 
-    /* 每次申请最少4页 */
-    /* if (size < 4 * PAGESIZE)
-    {
-        size = 4 * PAGESIZE;
-    } */
+    if (size < arenaSize) {
+        size = arenaSize;
+    }
 
     Mem_Ctrl_Blk *bigBlock = mapMemory(size);
+    if (!bigBlock) {
+        return NULL;
+    }
+    if (arenaSize < ARENA_MAX_SIZE) {
+        arenaSize *= 2;
+    }
     Mem_Ctrl_Blk *block = bigBlock + 1;
     Mem_Ctrl_Blk *endBlock = (void *)bigBlock + size - sizeof(Mem_Ctrl_Blk);
 
@@ -98,6 +128,226 @@ Mem_Ctrl_Blk *__allocateBigBlock(Mem_Ctrl_Blk *lastBigBlock, size_t size)
     return bigBlock;
 }
 
+/* 小块分类链表及表示哪些链表非空的位图 */
+static Mem_Ctrl_Blk *smallBins[SMALL_CLASS_COUNT];
+static uint32_t smallMap;
+/* 大块字典树的根 */
+static Mem_Ctrl_Blk *treeRoot;
+
+/* 字典树从size_t的最高位开始逐位区分 */
+#define TREE_TOP_SHIFT (sizeof(size_t) * 8 - 1)
+
+static inline unsigned int smallIndex(size_t size)
+{
+    return (size - 1) / SMALL_CLASS_STEP;
+}
+
+static void insertSmallBlock(Mem_Ctrl_Blk *block)
+{
+    unsigned int index = smallIndex(block->size);
+    Free_Blk *link = FREE_BLK(block);
+    link->prevFree = NULL;
+    link->nextFree = smallBins[index];
+    if (smallBins[index]) {
+        FREE_BLK(smallBins[index])->prevFree = block;
+    }
+    smallBins[index] = block;
+    smallMap |= 1U << index;
+}
+
+static void removeSmallBlock(Mem_Ctrl_Blk *block)
+{
+    unsigned int index = smallIndex(block->size);
+    Free_Blk *link = FREE_BLK(block);
+    if (link->prevFree) {
+        FREE_BLK(link->prevFree)->nextFree = link->nextFree;
+    } else {
+        smallBins[index] = link->nextFree;
+        if (!smallBins[index]) {
+            smallMap &= ~(1U << index);
+        }
+    }
+    if (link->nextFree) {
+        FREE_BLK(link->nextFree)->prevFree = link->prevFree;
+    }
+}
+
+/**
+ * 将大块放入字典树，从根开始按大小的二进制位选择左右子树，遇到大小相同的块则加入其环中
+ */
+static void insertTreeBlock(Mem_Ctrl_Blk *block)
+{
+    Free_Blk *link = FREE_BLK(block);
+    link->child[0] = NULL;
+    link->child[1] = NULL;
+    link->prevFree = block;
+    link->nextFree = block;
+    if (!treeRoot) {
+        link->parent = NULL;
+        treeRoot = block;
+        return;
+    }
+
+    Mem_Ctrl_Blk *current = treeRoot;
+    size_t shift = TREE_TOP_SHIFT;
+    while (1) {
+        Free_Blk *currentLink = FREE_BLK(current);
+        if (current->size == block->size) {
+            link->parent = NULL;
+            link->prevFree = current;
+            link->nextFree = currentLink->nextFree;
+            FREE_BLK(currentLink->nextFree)->prevFree = block;
+            currentLink->nextFree = block;
+            return;
+        }
+        Mem_Ctrl_Blk **child = &currentLink->child[(block->size >> shift) & 1];
+        if (!*child) {
+            link->parent = current;
+            *child = block;
+            return;
+        }
+        current = *child;
+        shift--;
+    }
+}
+
+/**
+ * 将大块从字典树移除，若其环中还有同样大小的块，由该块代替它在树中的位置，
+ * 否则用其子树中任意一个叶子代替（子树中的键与它有相同的前缀）
+ */
+static void removeTreeBlock(Mem_Ctrl_Blk *block)
+{
+    Free_Blk *link = FREE_BLK(block);
+    int inTree = block == treeRoot || link->parent;
+    Mem_Ctrl_Blk *replacement = NULL;
+
+    if (link->nextFree != block) {
+        FREE_BLK(link->prevFree)->nextFree = link->nextFree;
+        FREE_BLK(link->nextFree)->prevFree = link->prevFree;
+        if (!inTree) {
+            return;
+        }
+        replacement = link->nextFree;
+    } else if (link->child[0] || link->child[1]) {
+        Mem_Ctrl_Blk *leaf = block;
+        while (FREE_BLK(leaf)->child[0] || FREE_BLK(leaf)->child[1]) {
+            leaf = FREE_BLK(leaf)->child[1] ? FREE_BLK(leaf)->child[1] : FREE_BLK(leaf)->child[0];
+        }
+        Free_Blk *leafParent = FREE_BLK(FREE_BLK(leaf)->parent);
+        leafParent->child[leafParent->child[1] == leaf] = NULL;
+        replacement = leaf;
+    }
+
+    if (replacement) {
+        Free_Blk *replacementLink = FREE_BLK(replacement);
+        replacementLink->parent = link->parent;
+        replacementLink->child[0] = link->child[0];
+        replacementLink->child[1] = link->child[1];
+        if (link->child[0]) {
+            FREE_BLK(link->child[0])->parent = replacement;
+        }
+        if (link->child[1]) {
+            FREE_BLK(link->child[1])->parent = replacement;
+        }
+    }
+    if (!link->parent) {
+        treeRoot = replacement;
+    } else {
+        Free_Blk *parentLink = FREE_BLK(link->parent);
+        parentLink->child[parentLink->child[1] == block] = replacement;
+    }
+}
+
+/**
+ * 在字典树中查找不小于size的最小块
+ * 沿size的二进制位向下查找，途经的块都是候选；size某位为0时，该处右子树中的块都比size大，
+ * 记下最深的这样一棵子树，若路径上没有完全相等的块，再在其中沿最左路径找最小的块
+ */
+static Mem_Ctrl_Blk *findTreeBlock(size_t size)
+{
+    Mem_Ctrl_Blk *best = NULL;
+    size_t bestRest = SIZE_MAX;
+    Mem_Ctrl_Blk *larger = NULL;
+    Mem_Ctrl_Blk *current = treeRoot;
+    size_t shift = TREE_TOP_SHIFT;
+
+    while (current) {
+        if (current->size >= size && current->size - size < bestRest) {
+            best = current;
+            bestRest = current->size - size;
+            if (bestRest == 0) {
+                return best;
+            }
+        }
+        Free_Blk *link = FREE_BLK(current);
+        int bit = (size >> shift) & 1;
+        if (!bit && link->child[1]) {
+            larger = link->child[1];
+        }
+        current = link->child[bit];
+        shift--;
+    }
+
+    current = larger;
+    while (current) {
+        if (current->size - size < bestRest) {
+            best = current;
+            bestRest = current->size - size;
+        }
+        Free_Blk *link = FREE_BLK(current);
+        current = link->child[0] ? link->child[0] : link->child[1];
+    }
+    return best;
+}
+
+/**
+ * 将空闲块放入对应的空闲链表或字典树
+ */
+void __insertFreeBlock(Mem_Ctrl_Blk *block)
+{
+    assert(block->magic == MAGIC_FREE_MCB);
+    if (block->size <= SMALL_CLASS_MAX) {
+        insertSmallBlock(block);
+    } else {
+        insertTreeBlock(block);
+    }
+}
+
+/**
+ * 将空闲块从空闲链表或字典树中移除，合并或使用空闲块之前调用
+ */
+void __removeFreeBlock(Mem_Ctrl_Blk *block)
+{
+    assert(block->magic == MAGIC_FREE_MCB);
+    if (block->size <= SMALL_CLASS_MAX) {
+        removeSmallBlock(block);
+    } else {
+        removeTreeBlock(block);
+    }
+}
+
+/**
+ * 找到一个不小于size的空闲块并将其移除
+ * 小块直接取不小于size的第一个非空分类，通过位图是O(1)的；没有合适的小块时在字典树中找最佳匹配
+ */
+Mem_Ctrl_Blk *__findFreeBlock(size_t size)
+{
+    Mem_Ctrl_Blk *block;
+    if (size <= SMALL_CLASS_MAX) {
+        uint32_t map = smallMap & (~0U << smallIndex(size));
+        if (map) {
+            block = smallBins[__builtin_ctz(map)];
+            removeSmallBlock(block);
+            return block;
+        }
+    }
+    block = findTreeBlock(size);
+    if (block) {
+        removeTreeBlock(block);
+    }
+    return block;
+}
+
 /**
  * 将两个内存控制块合并，返回前一个的首地址
  */
@@ -143,58 +393,267 @@ void __splitBlock(Mem_Ctrl_Blk *block, size_t size)
     block->next = newBlock;
 }
 
+/**
+ * 为大内存申请单独映射一块内存，不经过Big_MCB，释放时直接取消映射
+ */
+void *__mapBlock(size_t size)
+{
+    size_t mapSize = ALIGN_UP(size + sizeof(Mem_Ctrl_Blk), PAGESIZE);
+    Mem_Ctrl_Blk *block = mapMemory(mapSize);
+    if (!block) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    block->magic = MAGIC_MAPPED_MCB;
+    block->size = mapSize - sizeof(Mem_Ctrl_Blk);
+    block->prev = NULL;
+    block->next = NULL;
+    __atomic_add_fetch(&__mappedBlockCount, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&__mappedBlockBytes, mapSize, __ATOMIC_RELAXED);
+    return (void *)(block + 1);
+}
+
+/**
+ * 每__profileInterval次分配记录一次调用者地址，同一调用者的采样合并计数
+ * 采样计数和记录都在__lockCache保护下进行，只在开启采样时调用
+ */
+static void sampleAllocation(void *caller, size_t size)
+{
+    unsigned long state = __lockCache();
+    if (profileCountdown == 0 || profileCountdown > __profileInterval) {
+        profileCountdown = __profileInterval;
+    }
+    if (--profileCountdown == 0) {
+        size_t i;
+        for (i = 0; i < PROFILE_MAX && __profileSamples[i].caller; i++) {
+            if (__profileSamples[i].caller == caller) {
+                break;
+            }
+        }
+        if (i < PROFILE_MAX) {
+            __profileSamples[i].caller = caller;
+            __profileSamples[i].count++;
+            __profileSamples[i].bytes += size;
+        } else {
+            __profileDropped++;
+        }
+    }
+    __unlockCache(state);
+}
+
+/* 已释放小块的缓存，INWOX只运行在一个CPU上，一组缓存即是每个CPU（用户进程中为每个进程）一组 */
+static Mem_Ctrl_Blk *cacheBins[SMALL_CLASS_COUNT];
+static unsigned int cacheCounts[SMALL_CLASS_COUNT];
+
+/**
+ * 从缓存中取一个大小恰好为size的块，需持有__lockCache
+ */
+static Mem_Ctrl_Blk *popCachedBlock(size_t size)
+{
+    unsigned int index = smallIndex(size);
+    Mem_Ctrl_Blk *block = cacheBins[index];
+    if (block) {
+        assert(block->magic == MAGIC_CACHED_MCB);
+        cacheBins[index] = FREE_BLK(block)->nextFree;
+        cacheCounts[index]--;
+        block->magic = MAGIC_USED_MCB;
+    }
+    return block;
+}
+
+/**
+ * 将块放入缓存，需持有__lockCache
+ */
+static void pushCachedBlock(Mem_Ctrl_Blk *block)
+{
+    unsigned int index = smallIndex(block->size);
+    block->magic = MAGIC_CACHED_MCB;
+    FREE_BLK(block)->nextFree = cacheBins[index];
+    cacheBins[index] = block;
+    cacheCounts[index]++;
+}
+
+/**
+ * 缓存中没有合适的块时，持有一次堆锁取出CACHE_BATCH个块，返回其中一个，其余放入缓存
+ * 堆锁和缓存锁不同时持有，获取堆锁时可能需要让出CPU
+ */
+static Mem_Ctrl_Blk *refillCache(size_t size)
+{
+    Mem_Ctrl_Blk *blocks[CACHE_BATCH];
+    size_t count = 0;
+    __lockHeap();
+    while (count < CACHE_BATCH) {
+        Mem_Ctrl_Blk *block = __allocateBlock(size);
+        if (!block) {
+            break;
+        }
+        blocks[count++] = block;
+    }
+    __unlockHeap();
+    if (count == 0) {
+        return NULL;
+    }
+
+    unsigned long state = __lockCache();
+    for (size_t i = 1; i < count; i++) {
+        /* 未切分的块可能比size稍大，放入其实际大小对应的分类 */
+        if (blocks[i]->size <= SMALL_CLASS_MAX && cacheCounts[smallIndex(blocks[i]->size)] < CACHE_BIN_MAX) {
+            pushCachedBlock(blocks[i]);
+            blocks[i] = NULL;
+        }
+    }
+    __unlockCache(state);
+
+    /* 对应分类已满时多出来的块直接归还 */
+    __lockHeap();
+    for (size_t i = 1; i < count; i++) {
+        if (blocks[i]) {
+            __releaseBlock(blocks[i]);
+        }
+    }
+    __unlockHeap();
+    return blocks[0];
+}
+
+/**
+ * 将释放的小块放入缓存，缓存满时将最早放入的CACHE_BATCH个块一次归还给堆
+ */
+void __cacheBlock(Mem_Ctrl_Blk *block)
+{
+    Mem_Ctrl_Blk *drained = NULL;
+    unsigned int index = smallIndex(block->size);
+    unsigned long state = __lockCache();
+    if (cacheCounts[index] == CACHE_BIN_MAX) {
+        /* 新放入的块在链表头部，跳过最近的块，取出尾部的块 */
+        Mem_Ctrl_Blk *last = cacheBins[index];
+        for (unsigned int i = 1; i < CACHE_BIN_MAX - CACHE_BATCH; i++) {
+            last = FREE_BLK(last)->nextFree;
+        }
+        drained = FREE_BLK(last)->nextFree;
+        FREE_BLK(last)->nextFree = NULL;
+        cacheCounts[index] -= CACHE_BATCH;
+    }
+    pushCachedBlock(block);
+    __unlockCache(state);
+
+    if (!drained) {
+        return;
+    }
+    __lockHeap();
+    while (drained) {
+        Mem_Ctrl_Blk *next = FREE_BLK(drained)->nextFree;
+        drained->magic = MAGIC_USED_MCB;
+        __releaseBlock(drained);
+        drained = next;
+    }
+    __unlockHeap();
+}
+
+/**
+ * 将缓存中的块全部归还给堆，需持有__lockHeap
+ * 
+ * @return int 缓存中是否有块
+ */
+static int flushCache(void)
+{
+    Mem_Ctrl_Blk *flushed[SMALL_CLASS_COUNT];
+    unsigned long state = __lockCache();
+    for (unsigned int i = 0; i < SMALL_CLASS_COUNT; i++) {
+        flushed[i] = cacheBins[i];
+        cacheBins[i] = NULL;
+        cacheCounts[i] = 0;
+    }
+    __unlockCache(state);
+
+    int result = 0;
+    for (unsigned int i = 0; i < SMALL_CLASS_COUNT; i++) {
+        Mem_Ctrl_Blk *block = flushed[i];
+        while (block) {
+            Mem_Ctrl_Blk *next = FREE_BLK(block)->nextFree;
+            block->magic = MAGIC_USED_MCB;
+            __releaseBlock(block);
+            block = next;
+            result = 1;
+        }
+    }
+    return result;
+}
+
+/**
+ * 从堆中分配size大小的块，需持有__lockHeap
+ * 需要申请新的Big_MCB之前先将缓存的块归还给堆并合并，避免缓存中零散的块占住大量Big_MCB
+ */
+Mem_Ctrl_Blk *__allocateBlock(size_t size)
+{
+    Mem_Ctrl_Blk *block = __findFreeBlock(size);
+    if (!block && flushCache()) {
+        block = __findFreeBlock(size);
+    }
+    if (block) {
+        if (block->prev == NULL && block->next->magic == MAGIC_END_MCB) {
+            /* 使用了一个保留的空闲Big_MCB */
+            __retainedArenaSize -= (block - 1)->size;
+        }
+    } else {
+        /* 没有足够大的空闲块，分配新的Big_MCB并链在最后 */
+        Mem_Ctrl_Blk *lastBigBlock = firstBigBlock;
+        while (lastBigBlock->next) {
+            lastBigBlock = lastBigBlock->next;
+        }
+        Mem_Ctrl_Blk *bigBlock = __allocateBigBlock(lastBigBlock, size);
+        if (!bigBlock) {
+            return NULL;
+        }
+        block = bigBlock + 1;
+    }
+
+    assert(block->magic == MAGIC_FREE_MCB);
+    if (block->size > sizeof(Mem_Ctrl_Blk) + size) {
+        __splitBlock(block, size);
+        __insertFreeBlock(block->next);
+    }
+    block->magic = MAGIC_USED_MCB;
+    return block;
+}
+
 void *malloc(size_t size)
 {
     if (size == 0) {
         size = 1;
     }
-    size_t blockSize = sizeof(Mem_Ctrl_Blk);
+    if (size > SIZE_MAX / 2) {
+        errno = ENOMEM;
+        return NULL;
+    }
 
     /* 16字节对齐 */
     size = ALIGN_UP(size, alignof(max_align_t));
-    size_t totalSize = blockSize + size;
 
-    __lockHeap();
+    if (__profileInterval) {
+        sampleAllocation(__builtin_return_address(0), size);
+    }
 
-    Mem_Ctrl_Blk *currentBigBlock = firstBigBlock;
-    Mem_Ctrl_Blk *currentBlock = currentBigBlock + 1;
+    if (size >= __mmapThreshold) {
+        return __mapBlock(size);
+    }
 
-    while (1) {
-        switch (currentBlock->magic) {
-            case MAGIC_FREE_MCB:
-                if (currentBlock->size >= size) {
-                    /* 找到需要的块 */
-                    if (currentBlock->size > totalSize) {
-                        __splitBlock(currentBlock, size);
-                    }
-                    currentBlock->magic = MAGIC_USED_MCB;
-                    __unlockHeap();
-                    return (void *)(currentBlock + 1);
-                } else {
-                    currentBlock = currentBlock->next;
-                }
-                break;
-            case MAGIC_USED_MCB:
-                currentBlock = currentBlock->next;
-                break;
-            case MAGIC_END_MCB:
-                /* 若遇到大内存控制块结束，去下一个大内存控制块找，若还没有，则分配新的Big_MCB */
-                if (currentBigBlock->next) {
-                    currentBigBlock = currentBigBlock->next;
-                    currentBlock = currentBigBlock + 1;
-                } else {
-                    currentBigBlock = __allocateBigBlock(currentBigBlock, size);
-                    currentBlock = currentBigBlock + 1;
-                    if (!currentBigBlock) {
-                        errno = ENOMEM;
-                        __unlockHeap();
-                        return NULL;
-                    }
-                }
-                break;
-            default:
-                __unlockHeap();
-                return NULL;
+    Mem_Ctrl_Blk *block;
+    if (size <= SMALL_CLASS_MAX) {
+        /* 小块优先从缓存中取，不需要获取堆锁 */
+        unsigned long state = __lockCache();
+        block = popCachedBlock(size);
+        __unlockCache(state);
+        if (!block) {
+            block = refillCache(size);
         }
+    } else {
+        __lockHeap();
+        block = __allocateBlock(size);
+        __unlockHeap();
+    }
+    if (!block) {
+        errno = ENOMEM;
+        return NULL;
     }
+    return (void *)(block + 1);
 }
@@ -25,21 +25,32 @@
  * libc/src/stdlib/malloc.c
  * 定义malloc内部实现所需语句
  */
-#ifndef MALLOC_H
-#define MALLOC_H
+#ifndef STDLIB_MALLOC_H
+#define STDLIB_MALLOC_H
 
 #include <stddef.h> /* size_t */
 #include <stdlib.h>
 
 #if __is_inwox_libc
 #include <sys/mman.h>
-#define mapMemory(size)         mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+static inline void *mapMemory(size_t size)
+{
+    void *result = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return result == MAP_FAILED ? NULL : result;
+}
 #define unmapMemory(addr, size) munmap(addr, size)
+static inline void *remapMemory(void *addr, size_t oldSize, size_t newSize)
+{
+    void *result = mremap(addr, oldSize, newSize, MREMAP_MAYMOVE);
+    return result == MAP_FAILED ? NULL : result;
+}
 #else /* if __is_inwox_libk */
 extern void *__mapMemory(size_t);
 extern void __unmapMemory(void *, size_t);
-#define mapMemory(size)         __mapMemory(size)
-#define unmapMemory(addr, size) __unmapMemory(addr, size)
+extern void *__remapMemory(void *, size_t, size_t);
+#define mapMemory(size)                      __mapMemory(size)
+#define unmapMemory(addr, size)              __unmapMemory(addr, size)
+#define remapMemory(addr, oldSize, newSize) __remapMemory(addr, oldSize, newSize)
 #endif
 typedef struct Mem_Ctrl_Blk {
     size_t magic;
@@ -52,18 +63,93 @@ typedef struct Mem_Ctrl_Blk {
 #define MAGIC_FREE_MCB 0xBEEFBEEF
 #define MAGIC_USED_MCB 0xDEADBEEF
 #define MAGIC_END_MCB  0xDEADDEAD
+/* 单独映射的内存块，size为可用大小，所在映射的长度为size加上一个控制块 */
+#define MAGIC_MAPPED_MCB 0xCAFEC0DE
+/* 已释放但留在缓存中的小块，对堆而言仍是使用中的块，不会被合并 */
+#define MAGIC_CACHED_MCB 0xCACEBEEF
+
+/**
+ * 空闲块的链接信息，存放在空闲块的数据区中（数据区至少16字节）
+ * 小块按大小分类，每类一个双向链表，只使用prevFree和nextFree；
+ * 大块组织成以大小为键的二进制字典树，用于最佳匹配查找，大小相同的块通过prevFree和nextFree连成环，
+ * 环中只有一个块挂在树上，child和parent只对树上的块有效，其他块的parent为NULL
+ */
+typedef struct Free_Blk {
+    Mem_Ctrl_Blk *prevFree;
+    Mem_Ctrl_Blk *nextFree;
+    Mem_Ctrl_Blk *child[2];
+    Mem_Ctrl_Blk *parent;
+} Free_Blk;
+
+#define FREE_BLK(block) ((Free_Blk *)((block) + 1))
+
+/* 小块分类，数据区16字节到512字节，每16字节一类，更大的块放入树中 */
+#define SMALL_CLASS_STEP  16
+#define SMALL_CLASS_COUNT 32
+#define SMALL_CLASS_MAX   (SMALL_CLASS_STEP * SMALL_CLASS_COUNT)
 
 #define PAGESIZE 0x1000
 
+/**
+ * 申请大小不小于mmap阈值时单独映射，Big_MCB从ARENA_MIN_SIZE开始每次加倍，直到ARENA_MAX_SIZE，
+ * 以减少映射次数。内核的堆在映射时就分配物理内存，所以各项取值较小
+ */
+#ifdef __is_inwox_libc
+#define MMAP_THRESHOLD_DEFAULT (128 * 1024)
+#define TRIM_THRESHOLD_DEFAULT (128 * 1024)
+#define ARENA_MIN_SIZE         (16 * PAGESIZE)
+#define ARENA_MAX_SIZE         (256 * PAGESIZE)
+#else
+#define MMAP_THRESHOLD_DEFAULT (64 * 1024)
+#define TRIM_THRESHOLD_DEFAULT (64 * 1024)
+#define ARENA_MIN_SIZE         (4 * PAGESIZE)
+#define ARENA_MAX_SIZE         (64 * PAGESIZE)
+#endif
+
+/**
+ * 每个上下文（内核中为每个CPU）缓存的已释放小块，每个小块分类一个单链表，通过数据区中的nextFree连接。
+ * 缓存的分配和释放只需要__lockCache，缓存为空时一次从堆中取CACHE_BATCH个块，缓存满时一次归还CACHE_BATCH个块
+ */
+#define CACHE_BIN_MAX 8
+#define CACHE_BATCH   4
+
 #define ALIGN_UP(value, alignment) ((((value)-1) & ~((alignment)-1)) + (alignment))
 
+/* 分配采样按调用者地址汇总，最多记录PROFILE_MAX个不同的调用者 */
+#define PROFILE_MAX 64
+
+typedef struct Profile_Sample {
+    void *caller;
+    size_t count;
+    size_t bytes;
+} Profile_Sample;
+
 extern Mem_Ctrl_Blk *firstBigBlock;
+extern size_t __mmapThreshold;
+extern size_t __trimThreshold;
+extern size_t __retainedArenaSize;
+/* 单独映射的块的个数和总字节数，在堆锁之外更新，使用原子操作 */
+extern size_t __mappedBlockCount;
+extern size_t __mappedBlockBytes;
+extern size_t __profileInterval;
+extern Profile_Sample __profileSamples[PROFILE_MAX];
+extern size_t __profileDropped;
 
 Mem_Ctrl_Blk *__allocateBigBlock(Mem_Ctrl_Blk *lastBigBlock, size_t size);
+Mem_Ctrl_Blk *__allocateBlock(size_t size);
+void __releaseBlock(Mem_Ctrl_Blk *block);
+void __cacheBlock(Mem_Ctrl_Blk *block);
+void *__mapBlock(size_t size);
 void __splitBlock(Mem_Ctrl_Blk *block, size_t size);
 Mem_Ctrl_Blk *__unifyBlocks(Mem_Ctrl_Blk *first, Mem_Ctrl_Blk *second);
+void __insertFreeBlock(Mem_Ctrl_Blk *block);
+void __removeFreeBlock(Mem_Ctrl_Blk *block);
+Mem_Ctrl_Blk *__findFreeBlock(size_t size);
 
 void __lockHeap(void);
 void __unlockHeap(void);
+unsigned long __lockCache(void);
+void __unlockCache(unsigned long state);
+void __mallocPrintf(const char *format, ...);
 
-#endif /* MALLOC_H */
+#endif /* STDLIB_MALLOC_H */
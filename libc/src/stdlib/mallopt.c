@@ -0,0 +1,64 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 - 2021 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * libc/src/stdlib/mallopt.c
+ * 调整内存分配器参数
+ */
+
+#include <malloc.h>
+#include "malloc.h"
+
+#ifdef __is_inwox_libc
+static int profileRegistered = 0;
+#endif
+
+int mallopt(int param, int value)
+{
+    if (value < 0) {
+        return 0;
+    }
+    __lockHeap();
+    switch (param) {
+        case M_TRIM_THRESHOLD:
+            __trimThreshold = value;
+            break;
+        case M_MMAP_THRESHOLD:
+            __mmapThreshold = value;
+            break;
+        case M_PROFILE_INTERVAL:
+#ifdef __is_inwox_libc
+            /* 第一次开启采样时注册退出时的输出 */
+            if (value && !profileRegistered) {
+                profileRegistered = atexit(malloc_profile_dump) == 0;
+            }
+#endif
+            __profileInterval = value;
+            break;
+        default:
+            __unlockHeap();
+            return 0;
+    }
+    __unlockHeap();
+    return 1;
+}
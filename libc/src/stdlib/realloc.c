@@ -40,6 +40,7 @@ static void changeChunkSize(Mem_Ctrl_Blk *chunk, size_t sizeDiff)
     Mem_Ctrl_Blk *next = chunk->next;
     Mem_Ctrl_Blk *newNextChunk = (Mem_Ctrl_Blk *)((uintptr_t)next + sizeDiff);
     memmove(newNextChunk, next, sizeof(Mem_Ctrl_Blk));
+    newNextChunk->next->prev = newNextChunk;
     chunk->next = newNextChunk;
     chunk->size += sizeDiff;
     newNextChunk->size -= sizeDiff;
@@ -50,13 +51,37 @@ void *realloc(void *addr, size_t size)
     if (addr == NULL) {
         return malloc(size);
     }
-    __lockHeap();
-    Mem_Ctrl_Blk *chunk = (Mem_Ctrl_Blk *)addr - 1;
-    assert(chunk->magic == MAGIC_USED_MCB);
     if (size == 0) {
         size = 1;
     }
     size = ALIGN_UP(size, alignof(max_align_t));
+    Mem_Ctrl_Blk *chunk = (Mem_Ctrl_Blk *)addr - 1;
+    if (chunk->magic == MAGIC_MAPPED_MCB) {
+        /* 单独映射的块通过mremap改变映射大小，内核原地扩大或移动页表项，数据不需要复制 */
+        size_t oldMapSize = chunk->size + sizeof(Mem_Ctrl_Blk);
+        size_t newMapSize = ALIGN_UP(size + sizeof(Mem_Ctrl_Blk), PAGESIZE);
+        if (newMapSize == oldMapSize) {
+            return addr;
+        }
+        Mem_Ctrl_Blk *newChunk = remapMemory(chunk, oldMapSize, newMapSize);
+        if (newChunk) {
+            __atomic_add_fetch(&__mappedBlockBytes, newMapSize - oldMapSize, __ATOMIC_RELAXED);
+            newChunk->size = newMapSize - sizeof(Mem_Ctrl_Blk);
+            return (void *)(newChunk + 1);
+        }
+        if (size <= chunk->size) {
+            return addr;
+        }
+        void *newAddr = malloc(size);
+        if (newAddr == NULL) {
+            return NULL;
+        }
+        memcpy(newAddr, addr, chunk->size);
+        free(addr);
+        return newAddr;
+    }
+    __lockHeap();
+    assert(chunk->magic == MAGIC_USED_MCB);
     ssize_t sizeDiff = size - chunk->size;
     if (sizeDiff == 0) {
         __unlockHeap();
@@ -66,7 +91,10 @@ void *realloc(void *addr, size_t size)
     Mem_Ctrl_Blk *next = chunk->next;
     if (next->magic == MAGIC_FREE_MCB) {
         if ((sizeDiff > 0 && next->size > sizeDiff + sizeof(Mem_Ctrl_Blk)) || sizeDiff < 0) {
+            /* 后一个空闲块的位置和大小都会改变，需要重新放入空闲链表 */
+            __removeFreeBlock(next);
             changeChunkSize(chunk, sizeDiff);
+            __insertFreeBlock(chunk->next);
             __unlockHeap();
             return addr;
         }
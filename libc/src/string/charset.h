@@ -0,0 +1,57 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * libc/src/string/charset.h
+ * strspn、strcspn等函数使用的字符集合，每个字节值对应一位，构造一次后每个字符的查询为O(1)
+ */
+
+#ifndef STRING_CHARSET_H
+#define STRING_CHARSET_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t bits[256 / 32];
+} __charset_t;
+
+/*
+ * 将characters中的字符加入集合，withNul为真时'\0'也在集合中，遇到字符串结束时查询即可停止
+ */
+static inline void __charsetBuild(__charset_t *set, const char *characters, int withNul)
+{
+    for (unsigned int i = 0; i < 256 / 32; i++) {
+        set->bits[i] = 0;
+    }
+    set->bits[0] = withNul ? 1 : 0;
+    for (const unsigned char *c = (const unsigned char *)characters; *c; c++) {
+        set->bits[*c / 32] |= 1U << (*c % 32);
+    }
+}
+
+static inline int __charsetHas(const __charset_t *set, unsigned char c)
+{
+    return (set->bits[c / 32] >> (c % 32)) & 1;
+}
+
+#endif /* STRING_CHARSET_H */
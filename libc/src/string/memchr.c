@@ -0,0 +1,101 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * libc/src/string/memchr.c
+ * 在一块内存中查找第一个与c相同的字节
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "memfunc.h"
+
+static void *memchrWord(const void *src, int c, size_t size)
+{
+    const unsigned char *p = src;
+    unsigned char ch = (unsigned char)c;
+    for (; size && (uintptr_t)p & (WORD_SIZE - 1); p++, size--) {
+        if (*p == ch) {
+            return (void *)p;
+        }
+    }
+    uint32_t pattern = ch * WORD_ONES;
+    for (; size >= WORD_SIZE; p += WORD_SIZE, size -= WORD_SIZE) {
+        uint32_t mask = HAS_ZERO(*(const __word_t *)p ^ pattern);
+        if (mask) {
+            return (void *)(p + FIRST_BYTE(mask));
+        }
+    }
+    for (; size; p++, size--) {
+        if (*p == ch) {
+            return (void *)p;
+        }
+    }
+    return NULL;
+}
+
+#ifdef __is_inwox_libc
+/**
+ * 从src向下对齐开始每次比较16字节，忽略src之前的字节，找到的位置超出范围时返回NULL
+ * size常被传入SIZE_MAX表示不限长度，加上对齐偏移时不能溢出
+ */
+__attribute__((target("sse2"))) static void *memchrSse2(const void *src, int c, size_t size)
+{
+    if (!size) {
+        return NULL;
+    }
+    const unsigned char *p = (const unsigned char *)((uintptr_t)src & ~15);
+    size_t offset = (const unsigned char *)src - p;
+    size = size > SIZE_MAX - offset ? SIZE_MAX : size + offset;
+    __vec16_t pattern = (__vec16_t){0} + (char)c;
+    unsigned int mask = __matchBytes(p, pattern) & (~0U << offset);
+    while (!mask) {
+        if (size <= 16) {
+            return NULL;
+        }
+        p += 16;
+        size -= 16;
+        mask = __matchBytes(p, pattern);
+    }
+    size_t index = __builtin_ctz(mask);
+    return index < size ? (void *)(p + index) : NULL;
+}
+
+static void *memchrResolve(const void *src, int c, size_t size);
+static void *(*memchrImpl)(const void *, int, size_t) = memchrResolve;
+
+static void *memchrResolve(const void *src, int c, size_t size)
+{
+    memchrImpl = __cpuHasSse2() ? memchrSse2 : memchrWord;
+    return memchrImpl(src, c, size);
+}
+#endif
+
+void *memchr(const void *src, int c, size_t size)
+{
+#ifdef __is_inwox_libc
+    return memchrImpl(src, c, size);
+#else
+    return memchrWord(src, c, size);
+#endif
+}
@@ -27,11 +27,20 @@
  */
 
 #include <string.h>
+#include "memfunc.h"
 
+/**
+ * 比较的范围都是有效内存，x86允许不对齐的读取，直接按字比较到第一个不同的字，再逐字节找到结果
+ */
 int memcmp(const void *p1, const void *p2, size_t size)
 {
     const unsigned char *a = p1;
     const unsigned char *b = p2;
+    for (; size >= WORD_SIZE; a += WORD_SIZE, b += WORD_SIZE, size -= WORD_SIZE) {
+        if (*(const __uword_t *)a != *(const __uword_t *)b) {
+            break;
+        }
+    }
     for (size_t i = 0; i < size; i++) {
         if (a[i] < b[i]) {
             return -1;
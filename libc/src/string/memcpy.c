@@ -27,15 +27,98 @@
  */
 
 #include <string.h>
+#include "memfunc.h"
 
-void *memcpy(void *restrict dest, const void *restrict src, size_t size)
+/**
+ * 先逐字节复制到目标地址4字节对齐，再用rep movsl每次复制4字节，最后复制剩余的字节
+ * 复制总是从低地址向高地址进行，memmove在目标位于源之前时也使用这里的实现
+ */
+static void *memcpyRep(void *restrict dest, const void *restrict src, size_t size)
 {
+    void *d = dest;
+    const void *s = src;
+    if (size >= REP_THRESHOLD) {
+        size_t head = -(uintptr_t)d & 3;
+        size -= head;
+        size_t words = size / 4;
+        size &= 3;
+        __asm__ __volatile__("rep movsb" : "+D"(d), "+S"(s), "+c"(head) : : "memory");
+        __asm__ __volatile__("rep movsl" : "+D"(d), "+S"(s), "+c"(words) : : "memory");
+    }
+    __asm__ __volatile__("rep movsb" : "+D"(d), "+S"(s), "+c"(size) : : "memory");
+    return dest;
+}
+
+#ifdef __is_inwox_libc
+/**
+ * 先将目标地址对齐到16字节，然后每次读入64字节再写出，源地址不一定对齐，使用movdqu读取
+ * 很大的复制使用movntdq写入，结束后用sfence保证这些写入对之后的访问可见
+ */
+__attribute__((target("sse2"))) static void *memcpySse2(void *restrict dest, const void *restrict src, size_t size)
+{
+    if (size < SSE2_THRESHOLD) {
+        return memcpyRep(dest, src, size);
+    }
     unsigned char *d = dest;
     const unsigned char *s = src;
+    size_t head = -(uintptr_t)d & 15;
+    size -= head;
+    __asm__ __volatile__("rep movsb" : "+D"(d), "+S"(s), "+c"(head) : : "memory");
+    size_t blocks = size / 64;
+    size &= 63;
 
-    for (size_t i = 0; i < size; i++) {
-        d[i] = s[i];
+    if (blocks * 64 >= NONTEMPORAL_THRESHOLD) {
+        for (; blocks; blocks--, d += 64, s += 64) {
+            __asm__ __volatile__("movdqu (%1), %%xmm0\n\t"
+                                 "movdqu 16(%1), %%xmm1\n\t"
+                                 "movdqu 32(%1), %%xmm2\n\t"
+                                 "movdqu 48(%1), %%xmm3\n\t"
+                                 "movntdq %%xmm0, (%0)\n\t"
+                                 "movntdq %%xmm1, 16(%0)\n\t"
+                                 "movntdq %%xmm2, 32(%0)\n\t"
+                                 "movntdq %%xmm3, 48(%0)"
+                                 :
+                                 : "r"(d), "r"(s)
+                                 : "xmm0", "xmm1", "xmm2", "xmm3", "memory");
+        }
+        __asm__ __volatile__("sfence" : : : "memory");
+    } else {
+        for (; blocks; blocks--, d += 64, s += 64) {
+            __asm__ __volatile__("movdqu (%1), %%xmm0\n\t"
+                                 "movdqu 16(%1), %%xmm1\n\t"
+                                 "movdqu 32(%1), %%xmm2\n\t"
+                                 "movdqu 48(%1), %%xmm3\n\t"
+                                 "movdqa %%xmm0, (%0)\n\t"
+                                 "movdqa %%xmm1, 16(%0)\n\t"
+                                 "movdqa %%xmm2, 32(%0)\n\t"
+                                 "movdqa %%xmm3, 48(%0)"
+                                 :
+                                 : "r"(d), "r"(s)
+                                 : "xmm0", "xmm1", "xmm2", "xmm3", "memory");
+        }
     }
-
+    memcpyRep(d, s, size);
     return dest;
 }
+
+static void *memcpyResolve(void *restrict dest, const void *restrict src, size_t size);
+static void *(*memcpyImpl)(void *restrict, const void *restrict, size_t) = memcpyResolve;
+
+/**
+ * 第一次调用时通过CPUID选择实现，之后直接调用选中的实现
+ */
+static void *memcpyResolve(void *restrict dest, const void *restrict src, size_t size)
+{
+    memcpyImpl = __cpuHasSse2() ? memcpySse2 : memcpyRep;
+    return memcpyImpl(dest, src, size);
+}
+#endif
+
+void *memcpy(void *restrict dest, const void *restrict src, size_t size)
+{
+#ifdef __is_inwox_libc
+    return memcpyImpl(dest, src, size);
+#else
+    return memcpyRep(dest, src, size);
+#endif
+}
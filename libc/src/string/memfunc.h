@@ -0,0 +1,93 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * libc/src/string/memfunc.h
+ * 内存和字符串函数共用的长度阈值、按字处理的方法和CPU特性检测
+ */
+
+#ifndef STRING_MEMFUNC_H
+#define STRING_MEMFUNC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* 长度不小于此值时先将目标地址对齐到4字节，再每次处理4字节 */
+#define REP_THRESHOLD 16
+/* 长度不小于此值时使用SSE2，每次处理64字节 */
+#define SSE2_THRESHOLD 256
+/* 长度不小于此值时使用非临时存储，写入不经过缓存，避免大块数据冲掉缓存中的其他数据 */
+#define NONTEMPORAL_THRESHOLD (256 * 1024)
+
+/**
+ * 字符串函数每次处理4字节，先逐字节处理到4字节对齐，对齐的读取不会跨页，即使读到字符串结束之后也不会访问未映射的内存
+ */
+typedef uint32_t __attribute__((__may_alias__)) __word_t;
+/* 允许不对齐访问的字，只用于读取范围确定有效的内存 */
+typedef uint32_t __attribute__((__may_alias__, __aligned__(1))) __uword_t;
+
+#define WORD_SIZE  4
+#define WORD_ONES  0x01010101U
+#define WORD_HIGHS 0x80808080U
+#define WORD_LOWS  0x7F7F7F7FU
+
+/**
+ * 字中有0字节时非0，最低的标记字节对应第一个0字节，更高的字节可能因借位被误标记
+ */
+#define HAS_ZERO(word) (((word) - WORD_ONES) & ~(word) & WORD_HIGHS)
+/* 精确标记字中的每个0字节，从高字节向低字节查找时使用 */
+#define ZERO_BYTES(word) (~((((word) & WORD_LOWS) + WORD_LOWS) | (word) | WORD_LOWS))
+/* 最低的标记字节在字中的序号（小端） */
+#define FIRST_BYTE(mask) ((size_t)__builtin_ctz(mask) / 8)
+/* 最高的标记字节在字中的序号（小端） */
+#define LAST_BYTE(mask) (3 - (size_t)__builtin_clz(mask) / 8)
+
+#ifdef __is_inwox_libc
+#define CPUID_SSE2 (1 << 26)
+
+/**
+ * SSE2实现每次比较对齐的16字节，与字一样不会跨页
+ */
+typedef char __vec16_t __attribute__((__vector_size__(16), __may_alias__));
+
+/**
+ * 比较p处对齐的16字节与pattern，返回相等字节的位掩码，第i位对应第i个字节
+ */
+__attribute__((target("sse2"))) static inline unsigned int __matchBytes(const void *p, __vec16_t pattern)
+{
+    return __builtin_ia32_pmovmskb128(*(const __vec16_t *)p == pattern);
+}
+
+/**
+ * 内核在CPU支持SSE2时开启SSE并在进程切换时保存SSE寄存器，所以用户程序通过CPUID判断即可
+ * 内核不保存自身使用的SSE寄存器，libk中只使用rep实现
+ */
+static inline int __cpuHasSse2(void)
+{
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    return (edx & CPUID_SSE2) != 0;
+}
+#endif
+
+#endif /* STRING_MEMFUNC_H */
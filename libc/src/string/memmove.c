@@ -30,20 +30,37 @@
  */
 
 #include <string.h>
+#include "memfunc.h"
 
 void *memmove(void *dest, const void *src, size_t size)
 {
-    unsigned char *d = dest;
-    const unsigned char *s = src;
+    /* 目标在源之前或两者不重叠时，memcpy从低地址向高地址复制，结果正确 */
+    if ((uintptr_t)dest - (uintptr_t)src >= size) {
+        return memcpy(dest, src, size);
+    }
+    if (dest == src) {
+        return dest;
+    }
 
-    if (src > dest) {
-        for (size_t i = 0; i < size; i++) {
-            d[i] = s[i];
-        }
-    } else {
-        for (size_t i = size; i > 0; i--) {
-            d[i - 1] = s[i - 1];
-        }
+    /**
+     * 目标与源的后部重叠，设置方向标志从高地址向低地址复制
+     * 先逐字节复制到目标的结束地址4字节对齐，再每次复制4字节，最后复制剩余的字节，
+     * rep每次执行后指针指向下一个待复制单元的起始处，按单元大小调整
+     */
+    unsigned char *d = (unsigned char *)dest + size - 1;
+    const unsigned char *s = (const unsigned char *)src + size - 1;
+    if (size >= REP_THRESHOLD) {
+        size_t tail = (uintptr_t)(d + 1) & 3;
+        size -= tail;
+        size_t words = size / 4;
+        size &= 3;
+        __asm__ __volatile__("std\n\trep movsb\n\tcld" : "+D"(d), "+S"(s), "+c"(tail) : : "memory");
+        d -= 3;
+        s -= 3;
+        __asm__ __volatile__("std\n\trep movsl\n\tcld" : "+D"(d), "+S"(s), "+c"(words) : : "memory");
+        d += 3;
+        s += 3;
     }
+    __asm__ __volatile__("std\n\trep movsb\n\tcld" : "+D"(d), "+S"(s), "+c"(size) : : "memory");
     return dest;
 }
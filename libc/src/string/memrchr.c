@@ -0,0 +1,59 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * libc/src/string/memrchr.c
+ * 在一块内存中查找最后一个与c相同的字节
+ */
+
+#include <string.h>
+#include "memfunc.h"
+
+/**
+ * 从结束地址向前按字查找，需要最高的匹配字节，使用精确标记每个0字节的ZERO_BYTES
+ */
+void *memrchr(const void *src, int c, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)src + size;
+    unsigned char ch = (unsigned char)c;
+    for (; size && (uintptr_t)p & (WORD_SIZE - 1); size--) {
+        if (*--p == ch) {
+            return (void *)p;
+        }
+    }
+    uint32_t pattern = ch * WORD_ONES;
+    for (; size >= WORD_SIZE; size -= WORD_SIZE) {
+        p -= WORD_SIZE;
+        uint32_t word = *(const __word_t *)p ^ pattern;
+        uint32_t mask = ZERO_BYTES(word);
+        if (mask) {
+            return (void *)(p + LAST_BYTE(mask));
+        }
+    }
+    while (size--) {
+        if (*--p == ch) {
+            return (void *)p;
+        }
+    }
+    return NULL;
+}
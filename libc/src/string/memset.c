@@ -27,13 +27,90 @@
  */
 
 #include <string.h>
+#include "memfunc.h"
 
-void *memset(void *dest, int value, size_t size)
+/**
+ * 先逐字节设置到目标地址4字节对齐，再用rep stosl每次设置4字节，最后设置剩余的字节
+ */
+static void *memsetRep(void *dest, int value, size_t size)
 {
-    unsigned char *p = dest;
-    for (size_t i = 0; i < size; i++) {
-        p[i] = (unsigned char)value;
+    void *d = dest;
+    uint32_t byte = (unsigned char)value;
+    if (size >= REP_THRESHOLD) {
+        size_t head = -(uintptr_t)d & 3;
+        size -= head;
+        size_t words = size / 4;
+        size &= 3;
+        __asm__ __volatile__("rep stosb" : "+D"(d), "+c"(head) : "a"(byte) : "memory");
+        __asm__ __volatile__("rep stosl" : "+D"(d), "+c"(words) : "a"(byte * 0x01010101U) : "memory");
     }
+    __asm__ __volatile__("rep stosb" : "+D"(d), "+c"(size) : "a"(byte) : "memory");
+    return dest;
+}
 
+#ifdef __is_inwox_libc
+/**
+ * 将字节广播到16字节的向量，先将目标地址对齐到16字节，然后每次写入64字节，很大的区域使用非临时存储
+ * 向量作为每个asm语句的输入，编译器不会在两个asm语句之间保留xmm寄存器的值
+ */
+__attribute__((target("sse2"))) static void *memsetSse2(void *dest, int value, size_t size)
+{
+    if (size < SSE2_THRESHOLD) {
+        return memsetRep(dest, value, size);
+    }
+    unsigned char *d = dest;
+    size_t head = -(uintptr_t)d & 15;
+    memsetRep(d, value, head);
+    d += head;
+    size -= head;
+    size_t blocks = size / 64;
+    size &= 63;
+
+    __vec16_t fill = (__vec16_t){0} + (char)value;
+    if (blocks * 64 >= NONTEMPORAL_THRESHOLD) {
+        for (; blocks; blocks--, d += 64) {
+            __asm__ __volatile__("movntdq %1, (%0)\n\t"
+                                 "movntdq %1, 16(%0)\n\t"
+                                 "movntdq %1, 32(%0)\n\t"
+                                 "movntdq %1, 48(%0)"
+                                 :
+                                 : "r"(d), "x"(fill)
+                                 : "memory");
+        }
+        __asm__ __volatile__("sfence" : : : "memory");
+    } else {
+        for (; blocks; blocks--, d += 64) {
+            __asm__ __volatile__("movdqa %1, (%0)\n\t"
+                                 "movdqa %1, 16(%0)\n\t"
+                                 "movdqa %1, 32(%0)\n\t"
+                                 "movdqa %1, 48(%0)"
+                                 :
+                                 : "r"(d), "x"(fill)
+                                 : "memory");
+        }
+    }
+    memsetRep(d, value, size);
     return dest;
 }
+
+static void *memsetResolve(void *dest, int value, size_t size);
+static void *(*memsetImpl)(void *, int, size_t) = memsetResolve;
+
+/**
+ * 第一次调用时通过CPUID选择实现，之后直接调用选中的实现
+ */
+static void *memsetResolve(void *dest, int value, size_t size)
+{
+    memsetImpl = __cpuHasSse2() ? memsetSse2 : memsetRep;
+    return memsetImpl(dest, value, size);
+}
+#endif
+
+void *memset(void *dest, int value, size_t size)
+{
+#ifdef __is_inwox_libc
+    return memsetImpl(dest, value, size);
+#else
+    return memsetRep(dest, value, size);
+#endif
+}
@@ -27,13 +27,63 @@
  */
 
 #include <string.h>
+#include "memfunc.h"
 
-char *strchr(const char *s, int c)
+/**
+ * 同时查找0字节和c，两个掩码中最低的标记字节都是准确的，合并后最低的标记字节即第一个0或c
+ */
+static char *strchrWord(const char *s, int c)
 {
-    do {
-        if (*s == (char)c) {
+    char ch = (char)c;
+    for (; (uintptr_t)s & (WORD_SIZE - 1); s++) {
+        if (*s == ch) {
             return (char *)s;
         }
-    } while (*s++);
-    return NULL;
+        if (!*s) {
+            return NULL;
+        }
+    }
+    uint32_t pattern = (unsigned char)ch * WORD_ONES;
+    const __word_t *word = (const __word_t *)s;
+    uint32_t mask;
+    while (!(mask = HAS_ZERO(*word) | HAS_ZERO(*word ^ pattern))) {
+        word++;
+    }
+    s = (const char *)word + FIRST_BYTE(mask);
+    return *s == ch ? (char *)s : NULL;
+}
+
+#ifdef __is_inwox_libc
+__attribute__((target("sse2"))) static char *strchrSse2(const char *s, int c)
+{
+    char ch = (char)c;
+    const char *p = (const char *)((uintptr_t)s & ~15);
+    __vec16_t zero = {0};
+    __vec16_t pattern = zero + ch;
+    unsigned int mask = (__matchBytes(p, zero) | __matchBytes(p, pattern)) & (~0U << (s - p));
+    while (!mask) {
+        p += 16;
+        mask = __matchBytes(p, zero) | __matchBytes(p, pattern);
+    }
+    p += __builtin_ctz(mask);
+    return *p == ch ? (char *)p : NULL;
+}
+
+static char *strchrResolve(const char *s, int c);
+static char *(*strchrImpl)(const char *, int) = strchrResolve;
+
+static char *strchrResolve(const char *s, int c)
+{
+    strchrImpl = __cpuHasSse2() ? strchrSse2 : strchrWord;
+    return strchrImpl(s, c);
+}
+#endif
+
+char *strchr(const char *s, int c)
+{
+#ifdef __is_inwox_libc
+    return strchrImpl(s, c);
+#else
+    return strchrWord(s, c);
+#endif
 }
@@ -26,22 +26,35 @@
  * 比较两个字符串
  */
 
-#include <stdbool.h>
 #include <string.h>
+#include "memfunc.h"
 
+/**
+ * 两个字符串对4字节的偏移相同时，逐字节比较到对齐后按字比较，直到字不同或字中有0字节，再逐字节找到结果
+ */
 int strcmp(const char *a, const char *b)
 {
-    for (size_t i = 0; true; i++) {
-        unsigned char ac = (unsigned char)a[i];
-        unsigned char bc = (unsigned char)b[i];
-        if (ac == '\0' && bc == '\0') {
-            return 0;
+    if ((((uintptr_t)a ^ (uintptr_t)b) & (WORD_SIZE - 1)) == 0) {
+        for (; (uintptr_t)a & (WORD_SIZE - 1); a++, b++) {
+            if (*a != *b || !*a) {
+                goto compareBytes;
+            }
         }
-        if (ac < bc) {
-            return -1;
-        }
-        if (ac > bc) {
-            return 1;
+        const __word_t *wordA = (const __word_t *)a;
+        const __word_t *wordB = (const __word_t *)b;
+        while (*wordA == *wordB && !HAS_ZERO(*wordA)) {
+            wordA++;
+            wordB++;
         }
+        a = (const char *)wordA;
+        b = (const char *)wordB;
+    }
+compareBytes:
+    while (*a && *a == *b) {
+        a++;
+        b++;
     }
+    unsigned char ac = (unsigned char)*a;
+    unsigned char bc = (unsigned char)*b;
+    return ac < bc ? -1 : ac > bc;
 }
@@ -26,19 +26,20 @@
  */
 
 #include <string.h>
+#include "charset.h"
 
 size_t strcspn(const char *string, const char *characters)
 {
-    size_t result = 0;
-
-    while (string[result]) {
-        for (size_t i = 0; characters[i]; i++) {
-            if (string[result] == characters[i]) {
-                return result;
-            }
-        }
-        result++;
+    /* 只有一个分隔符时使用按字查找的strchr */
+    if (characters[0] && !characters[1]) {
+        const char *match = strchr(string, characters[0]);
+        return match ? (size_t)(match - string) : strlen(string);
     }
-
-    return result;
+    __charset_t set;
+    __charsetBuild(&set, characters, 1);
+    const unsigned char *s = (const unsigned char *)string;
+    while (!__charsetHas(&set, *s)) {
+        s++;
+    }
+    return (const char *)s - string;
 }
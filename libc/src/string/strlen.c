@@ -27,13 +27,55 @@
  */
 
 #include <string.h>
+#include "memfunc.h"
 
-size_t strlen(const char *s)
+static size_t strlenWord(const char *s)
 {
-    size_t len = 0;
-    while (*s++) {
-        len++;
+    const char *p = s;
+    for (; (uintptr_t)p & (WORD_SIZE - 1); p++) {
+        if (!*p) {
+            return p - s;
+        }
+    }
+    const __word_t *word = (const __word_t *)p;
+    uint32_t mask;
+    while (!(mask = HAS_ZERO(*word))) {
+        word++;
     }
+    return (const char *)word + FIRST_BYTE(mask) - s;
+}
 
-    return len;
+#ifdef __is_inwox_libc
+/**
+ * 第一次比较从s向下对齐的16字节，忽略s之前的字节
+ */
+__attribute__((target("sse2"))) static size_t strlenSse2(const char *s)
+{
+    const char *p = (const char *)((uintptr_t)s & ~15);
+    __vec16_t zero = {0};
+    unsigned int mask = __matchBytes(p, zero) & (~0U << (s - p));
+    while (!mask) {
+        p += 16;
+        mask = __matchBytes(p, zero);
+    }
+    return p + __builtin_ctz(mask) - s;
+}
+
+static size_t strlenResolve(const char *s);
+static size_t (*strlenImpl)(const char *) = strlenResolve;
+
+static size_t strlenResolve(const char *s)
+{
+    strlenImpl = __cpuHasSse2() ? strlenSse2 : strlenWord;
+    return strlenImpl(s);
+}
+#endif
+
+size_t strlen(const char *s)
+{
+#ifdef __is_inwox_libc
+    return strlenImpl(s);
+#else
+    return strlenWord(s);
+#endif
 }
@@ -27,19 +27,34 @@
  */
 
 #include <string.h>
+#include "memfunc.h"
 
 int strncmp(const char *str1, const char *str2, size_t length)
 {
-    for (size_t i = 0; i < length; i++) {
-        unsigned char str1char = (unsigned char)str1[i];
-        unsigned char str2char = (unsigned char)str2[i];
-        if (str1char < str2char) {
-            return -1;
+    if ((((uintptr_t)str1 ^ (uintptr_t)str2) & (WORD_SIZE - 1)) == 0) {
+        for (; length && (uintptr_t)str1 & (WORD_SIZE - 1); str1++, str2++, length--) {
+            if (*str1 != *str2 || !*str1) {
+                goto compareBytes;
+            }
         }
-        if (str1char > str2char) {
-            return 1;
+        const __word_t *word1 = (const __word_t *)str1;
+        const __word_t *word2 = (const __word_t *)str2;
+        while (length >= WORD_SIZE && *word1 == *word2 && !HAS_ZERO(*word1)) {
+            word1++;
+            word2++;
+            length -= WORD_SIZE;
         }
-        if (str1char == '\0' && str2char == '\0') {
+        str1 = (const char *)word1;
+        str2 = (const char *)word2;
+    }
+compareBytes:
+    for (; length; str1++, str2++, length--) {
+        unsigned char str1char = (unsigned char)*str1;
+        unsigned char str2char = (unsigned char)*str2;
+        if (str1char != str2char) {
+            return str1char < str2char ? -1 : 1;
+        }
+        if (str1char == '\0') {
             return 0;
         }
     }
@@ -30,9 +30,6 @@
 
 size_t strnlen(const char *str, size_t maxlen)
 {
-    size_t ret = 0;
-    while (ret < maxlen && str[ret]) {
-        ret++;
-    }
-    return ret;
+    const char *end = memchr(str, '\0', maxlen);
+    return end ? (size_t)(end - str) : maxlen;
 }
@@ -27,15 +27,17 @@
 
 #include <string.h>
 
+/**
+ * 通过strchr依次找到每个c，最后一个即是结果
+ */
 char *strrchr(const char *s, int c)
 {
+    if (!(char)c) {
+        return (char *)s + strlen(s);
+    }
     const char *result = NULL;
-
-    do {
-        if (*s == (char)c) {
-            result = s;
-        }
-    } while (*s++);
-
+    while ((s = strchr(s, c))) {
+        result = s++;
+    }
     return (char *)result;
 }
@@ -26,16 +26,15 @@
  */
 
 #include <string.h>
+#include "charset.h"
 
 size_t strspn(const char *string, const char *characters)
 {
-    size_t result = 0;
-    while (1) {
-        for (size_t i = 0; characters[i]; i++) {
-            if (string[result] != characters[i]) {
-                return result;
-            }
-        }
-        result++;
+    __charset_t set;
+    __charsetBuild(&set, characters, 0);
+    const unsigned char *s = (const unsigned char *)string;
+    while (__charsetHas(&set, *s)) {
+        s++;
     }
+    return (const char *)s - string;
 }
@@ -29,24 +29,10 @@
 
 static char *next = NULL;
 
+/**
+ * 使用静态变量保存位置，不可重入，需要重入时使用strtok_r
+ */
 char *strtok(char *restrict str, const char *restrict seperator)
 {
-    if (!str) {
-        str = next;
-        if (!str) {
-            return NULL;
-        }
-    }
-    str = str + strspn(str, seperator);
-    if (!*str) {
-        return NULL;
-    }
-    size_t tokenEnd = strcspn(str, seperator);
-    if (str[tokenEnd] == '\0') {
-        next = NULL;
-    } else {
-        str[tokenEnd] = '\0';
-        next = str + tokenEnd + 1;
-    }
-    return str;
+    return strtok_r(str, seperator, &next);
 }
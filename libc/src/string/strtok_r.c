@@ -0,0 +1,51 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* libc/src/string/strtok_r.c
+ * 分割字符串，位置保存在调用者提供的savePtr中，可以重入
+ */
+
+#include <string.h>
+
+char *strtok_r(char *restrict str, const char *restrict seperator, char **restrict savePtr)
+{
+    if (!str) {
+        str = *savePtr;
+        if (!str) {
+            return NULL;
+        }
+    }
+    str = str + strspn(str, seperator);
+    if (!*str) {
+        *savePtr = NULL;
+        return NULL;
+    }
+    size_t tokenEnd = strcspn(str, seperator);
+    if (str[tokenEnd] == '\0') {
+        *savePtr = NULL;
+    } else {
+        str[tokenEnd] = '\0';
+        *savePtr = str + tokenEnd + 1;
+    }
+    return str;
+}
@@ -0,0 +1,86 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * libc/src/time/clock_gettime.c
+ * 读取时钟，直接读取内核共享的数据页而不进行系统调用
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <inwox/vdata.h>
+
+#define barrier() __asm__ __volatile__("" ::: "memory")
+
+static inline uint64_t rdtsc(void) {
+    uint32_t low, high;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+int clock_gettime(clockid_t clockid, struct timespec *result) {
+    if (clockid != CLOCK_REALTIME && clockid != CLOCK_MONOTONIC) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const volatile struct vdata *vdata = (const volatile struct vdata *)VDATA_ADDRESS;
+    uint32_t sequence;
+    uint32_t nsPerTick;
+    uint64_t ticks;
+    uint64_t tscAtTick;
+    uint64_t tsc;
+    uint32_t tscScale;
+    uint32_t tscShift;
+    time_t bootTime;
+
+    /* 内核正在更新时sequence为奇数，读取期间sequence变化说明数据不一致，均需重读 */
+    do {
+        sequence = vdata->sequence;
+        barrier();
+        nsPerTick = vdata->nsPerTick;
+        ticks = vdata->ticks;
+        tscAtTick = vdata->tscAtTick;
+        tscScale = vdata->tscScale;
+        tscShift = vdata->tscShift;
+        bootTime = vdata->bootTime;
+        tsc = tscScale ? rdtsc() : 0;
+        barrier();
+    } while ((sequence & 1) || vdata->sequence != sequence);
+
+    uint64_t nanoseconds = ticks * nsPerTick;
+    if (tscScale && tsc > tscAtTick) {
+        /* 用TSC补足距上次时钟中断的时间，但不超过一个时钟周期，保证时间不会回退 */
+        uint64_t delta = tsc - tscAtTick;
+        uint64_t offset = delta > UINT32_MAX ? nsPerTick : (delta * tscScale) >> tscShift;
+        nanoseconds += offset < nsPerTick ? offset : nsPerTick - 1;
+    }
+
+    result->tv_sec = nanoseconds / 1000000000;
+    result->tv_nsec = nanoseconds % 1000000000;
+    if (clockid == CLOCK_REALTIME) {
+        result->tv_sec += bootTime;
+    }
+    return 0;
+}
@@ -0,0 +1,202 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * test/memory.c
+ * 测试-memcpy()、memmove()、memset()
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* 与libc/src/string/memfunc.h中的阈值相同，长度在其前后时会走不同的分支 */
+#define REP_THRESHOLD 16
+#define SSE2_THRESHOLD 256
+#define NONTEMPORAL_THRESHOLD (256 * 1024)
+
+#define BUFFER_SIZE (NONTEMPORAL_THRESHOLD + 1024)
+
+static int test_count = 0;
+static int test_failed = 0;
+
+/* buffer为被测函数的结果，expected为逐字节计算的预期结果，比较前checked个字节，可以发现越界写入 */
+static unsigned char buffer[BUFFER_SIZE] __attribute__((aligned(16)));
+static unsigned char expected[BUFFER_SIZE] __attribute__((aligned(16)));
+static unsigned char source[BUFFER_SIZE] __attribute__((aligned(16)));
+static size_t checked;
+
+#define TEST_MEMORY(name, ret, dest, src, size)                                                            \
+    do {                                                                                                   \
+        test_count++;                                                                                      \
+        size_t diff = 0;                                                                                   \
+        while (diff < checked && buffer[diff] == expected[diff]) {                                         \
+            diff++;                                                                                        \
+        }                                                                                                  \
+        if ((ret) != buffer + (dest) || diff != checked) {                                                 \
+            test_failed++;                                                                                 \
+            printf("* FAIL: line %d, %s dest: %zu src: %zu size: %zu first difference: %zu\n", __LINE__,   \
+                   name, (size_t)(dest), (size_t)(src), (size_t)(size), diff);                             \
+        }                                                                                                  \
+    } while (0);
+
+static const size_t sizes[] = {
+    0, 1, 2, 3, 4, 5, 7, 8, 9,
+    REP_THRESHOLD - 4, REP_THRESHOLD - 3, REP_THRESHOLD - 2, REP_THRESHOLD - 1,
+    REP_THRESHOLD, REP_THRESHOLD + 1, REP_THRESHOLD + 2, REP_THRESHOLD + 3, REP_THRESHOLD + 4,
+    63, 64, 65,
+    SSE2_THRESHOLD - 4, SSE2_THRESHOLD - 3, SSE2_THRESHOLD - 2, SSE2_THRESHOLD - 1,
+    SSE2_THRESHOLD, SSE2_THRESHOLD + 1, SSE2_THRESHOLD + 2, SSE2_THRESHOLD + 3, SSE2_THRESHOLD + 4,
+    SSE2_THRESHOLD + 63, SSE2_THRESHOLD + 64, SSE2_THRESHOLD + 65, 1000,
+};
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+/* 移动的距离，包括小于一个字、一个字、一个向量和一次循环处理的字节数 */
+static const size_t distances[] = {1, 2, 3, 4, 5, 7, 8, 15, 16, 17, 63, 64, 65};
+#define NUM_DISTANCES (sizeof(distances) / sizeof(distances[0]))
+
+static void fill(unsigned char *data, size_t size, unsigned int seed)
+{
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = seed >> 16;
+    }
+}
+
+/* 预期结果不使用被测函数计算，volatile防止编译器把循环替换为memcpy/memset调用 */
+static void copyBytes(volatile unsigned char *dest, const unsigned char *src, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        dest[i] = src[i];
+    }
+}
+
+static void setBytes(volatile unsigned char *dest, unsigned char value, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        dest[i] = value;
+    }
+}
+
+/* 每次测试前重新填充两个缓冲区的前size个字节 */
+static void reset(size_t size, unsigned int seed)
+{
+    fill(buffer, size, seed);
+    copyBytes(expected, buffer, size);
+    checked = size;
+}
+
+static void test_memcpy()
+{
+    for (size_t i = 0; i < NUM_SIZES; i++) {
+        size_t size = sizes[i];
+        for (size_t dest = 0; dest < 16; dest++) {
+            for (size_t src = 0; src < 4; src++) {
+                reset(2048, i * 256 + dest * 16 + src);
+                fill(source, size + 16, ~i);
+                copyBytes(expected + dest, source + src, size);
+                void *ret = memcpy(buffer + dest, source + src, size);
+                TEST_MEMORY("memcpy", ret, dest, src, size)
+            }
+        }
+    }
+
+    // 超过非临时存储阈值的复制
+    for (size_t dest = 0; dest < 4; dest++) {
+        size_t size = NONTEMPORAL_THRESHOLD + 67;
+        reset(BUFFER_SIZE, dest);
+        fill(source, size + 16, ~dest);
+        copyBytes(expected + dest, source + 3, size);
+        void *ret = memcpy(buffer + dest, source + 3, size);
+        TEST_MEMORY("memcpy", ret, dest, 3, size)
+    }
+}
+
+static void test_memset()
+{
+    for (size_t i = 0; i < NUM_SIZES; i++) {
+        size_t size = sizes[i];
+        for (size_t dest = 0; dest < 16; dest++) {
+            reset(2048, i * 16 + dest);
+            int value = 0x80 + (int)dest;
+            setBytes(expected + dest, (unsigned char)value, size);
+            void *ret = memset(buffer + dest, value, size);
+            TEST_MEMORY("memset", ret, dest, 0, size)
+        }
+    }
+
+    for (size_t dest = 0; dest < 4; dest++) {
+        size_t size = NONTEMPORAL_THRESHOLD + 67;
+        reset(BUFFER_SIZE, dest);
+        setBytes(expected + dest, 0x5A, size);
+        void *ret = memset(buffer + dest, 0x15A, size);
+        TEST_MEMORY("memset", ret, dest, 0, size)
+    }
+}
+
+/**
+ * 目标在源之后时从高地址向低地址复制，目标在源之前时从低地址向高地址复制，两个方向都覆盖4种目标对齐
+ */
+static void test_memmove()
+{
+    for (size_t i = 0; i < NUM_SIZES; i++) {
+        size_t size = sizes[i];
+        for (size_t j = 0; j < NUM_DISTANCES; j++) {
+            size_t distance = distances[j];
+            for (size_t align = 0; align < 4; align++) {
+                // 目标在源之后
+                size_t src = 64 + align;
+                size_t dest = src + distance;
+                reset(2048, i * 1024 + j * 4 + align);
+                copyBytes(source, buffer + src, size);
+                copyBytes(expected + dest, source, size);
+                void *ret = memmove(buffer + dest, buffer + src, size);
+                TEST_MEMORY("memmove", ret, dest, src, size)
+
+                // 目标在源之前
+                dest = 64 + align;
+                src = dest + distance;
+                reset(2048, ~(i * 1024 + j * 4 + align));
+                copyBytes(source, buffer + src, size);
+                copyBytes(expected + dest, source, size);
+                ret = memmove(buffer + dest, buffer + src, size);
+                TEST_MEMORY("memmove", ret, dest, src, size)
+            }
+        }
+    }
+
+    // 源和目标相同
+    reset(2048, 0);
+    void *ret = memmove(buffer + 3, buffer + 3, SSE2_THRESHOLD + 1);
+    TEST_MEMORY("memmove", ret, 3, 3, SSE2_THRESHOLD + 1)
+}
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    test_memcpy();
+    test_memset();
+    test_memmove();
+    printf("Test: %d/%d\n", test_count - test_failed, test_count);
+    return 0;
+}
@@ -23,10 +23,11 @@
 
 /**
  * test/printf.c
- * 测试-sprintf()
+ * 测试-sprintf()、snprintf()、asprintf()
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static int test_count = 0;
@@ -43,6 +44,33 @@ static int test_failed = 0;
         }                                                                                                  \
     } while (0);
 
+#define TEST_SNPRINTF(buf, ret, size, fmt, ...)                                                            \
+    do {                                                                                                   \
+        test_count++;                                                                                      \
+        char lbuf[64];                                                                                     \
+        memset(lbuf, 'X', sizeof(lbuf));                                                                   \
+        int len = snprintf(lbuf, size, fmt, ##__VA_ARGS__);                                                \
+        if ((len != ret) || (size && strcmp(lbuf, buf)) ||                                                 \
+            (size < sizeof(lbuf) && lbuf[size] != 'X')) {                                                  \
+            test_failed++;                                                                                 \
+            printf("* FAIL: line %d, expect: '%s'(%d) actual: '%.*s'(%d)\n", __LINE__, buf, ret,           \
+                   (int)sizeof(lbuf), lbuf, len);                                                          \
+        }                                                                                                  \
+    } while (0);
+
+#define TEST_ASPRINTF(buf, ret, fmt, ...)                                                                  \
+    do {                                                                                                   \
+        test_count++;                                                                                      \
+        char *lbuf = NULL;                                                                                 \
+        int len = asprintf(&lbuf, fmt, ##__VA_ARGS__);                                                     \
+        if ((len != ret) || !lbuf || (strcmp(lbuf, buf))) {                                                \
+            test_failed++;                                                                                 \
+            printf("* FAIL: line %d, expect: '%s'(%d) actual: '%s'(%d)\n", __LINE__, buf, ret,             \
+                   lbuf ? lbuf : "(null)", len);                                                           \
+        }                                                                                                  \
+        free(lbuf);                                                                                        \
+    } while (0);
+
 static void test_print_base()
 {
     TEST_SPRINTF("Hello INWOX", 11, "Hello INWOX")
@@ -378,11 +406,43 @@ static void test_sprintf()
     test_print_inwox();
 }
 
+static void test_snprintf()
+{
+    TEST_SNPRINTF("Hello INWOX", 11, 64, "Hello INWOX")
+    TEST_SNPRINTF("Hello", 11, 6, "Hello INWOX")
+    TEST_SNPRINTF("", 11, 1, "Hello INWOX")
+    TEST_SNPRINTF("", 11, 0, "Hello INWOX")
+    TEST_SNPRINTF("1024", 4, 5, "%d", 1024)
+    TEST_SNPRINTF("102", 4, 4, "%d", 1024)
+    TEST_SNPRINTF("    ", 20, 5, "%20s", "INWOX")
+    TEST_SNPRINTF("-0000", 10, 6, "%010d", -1024)
+    TEST_SNPRINTF("0x12", 10, 5, "%#010x", 0x1234abcdu)
+}
+
+static void test_asprintf()
+{
+    int count = 0;
+
+    TEST_ASPRINTF("Hello INWOX", 11, "Hello INWOX")
+    TEST_ASPRINTF("", 0, "%s", "")
+    TEST_ASPRINTF("-1024 edcb5433 INWOX", 20, "%d %x %s", -1024, -0x1234abcdu, "INWOX")
+    TEST_ASPRINTF("                                                                            INWOX", 81, "%81s",
+                  "INWOX")
+    TEST_ASPRINTF("Hello INWOX", 11, "Hello %n%s", &count, "INWOX")
+    test_count++;
+    if (count != 6) {
+        test_failed++;
+        printf("* FAIL: line %d, expect: %d actual: %d\n", __LINE__, 6, count);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     (void)argc;
     (void)argv;
     test_sprintf();
+    test_snprintf();
+    test_asprintf();
     printf("Test: %d/%d\n", test_count - test_failed, test_count);
     return 0;
 }
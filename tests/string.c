@@ -0,0 +1,239 @@
+/** MIT License
+ *
+ * Copyright (c) 2020 Qv Junping
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * test/string.c
+ * 测试-strlen()、strchr()、memchr()、memrchr()、strcmp()、strncmp()
+ * 这些函数按对齐的字或16字节向量读取，测试覆盖每种起始偏移、字或向量首尾字节的匹配以及字符串在页末结束的情况
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define PAGE_SIZE 4096
+/* 测试的最大长度，覆盖3个16字节向量 */
+#define MAX_LENGTH 48
+
+static int test_count = 0;
+static int test_failed = 0;
+
+static char buffer[256] __attribute__((aligned(16)));
+static char other[256] __attribute__((aligned(16)));
+
+#define TEST_STRING(expr, offset, length, position)                                                        \
+    do {                                                                                                   \
+        test_count++;                                                                                      \
+        if (!(expr)) {                                                                                     \
+            test_failed++;                                                                                 \
+            printf("* FAIL: line %d, %s offset: %zu length: %zu position: %zu\n", __LINE__, #expr,         \
+                   (size_t)(offset), (size_t)(length), (size_t)(position));                                \
+        }                                                                                                  \
+    } while (0);
+
+static int sign(int value)
+{
+    return value < 0 ? -1 : value > 0;
+}
+
+/**
+ * 准备buffer：起始位置之前交替填入0和c，它们位于同一个对齐的字或向量中，必须被忽略，
+ * 从起始位置开始是length个不等于c的非0字节，之后是0，再之后又是c
+ */
+static char *prepare(size_t offset, size_t length, char c)
+{
+    for (size_t i = 0; i < offset; i++) {
+        buffer[i] = i & 1 ? c : 0;
+    }
+    char *s = buffer + offset;
+    for (size_t i = 0; i < length; i++) {
+        s[i] = (char)('a' + i % 26);
+    }
+    s[length] = '\0';
+    for (size_t i = length + 1; i < sizeof(buffer) - offset; i++) {
+        s[i] = c;
+    }
+    return s;
+}
+
+static void test_strlen()
+{
+    for (size_t offset = 0; offset < 16; offset++) {
+        for (size_t length = 0; length <= MAX_LENGTH; length++) {
+            char *s = prepare(offset, length, '\0');
+            TEST_STRING(strlen(s) == length, offset, length, length)
+        }
+    }
+}
+
+static void test_strchr()
+{
+    const char targets[] = {'#', (char)0xC8};
+    for (size_t t = 0; t < sizeof(targets); t++) {
+        char c = targets[t];
+        for (size_t offset = 0; offset < 16; offset++) {
+            for (size_t length = 0; length <= MAX_LENGTH; length++) {
+                char *s = prepare(offset, length, c);
+                TEST_STRING(strchr(s, c) == NULL, offset, length, length)
+                TEST_STRING(strchr(s, '\0') == s + length, offset, length, length)
+                for (size_t position = 0; position < length; position++) {
+                    char saved = s[position];
+                    s[position] = c;
+                    TEST_STRING(strchr(s, c) == s + position, offset, length, position)
+                    s[position] = saved;
+                }
+            }
+        }
+    }
+}
+
+static void test_memchr()
+{
+    const char targets[] = {'#', '\0', (char)0xC8};
+    for (size_t t = 0; t < sizeof(targets); t++) {
+        char c = targets[t];
+        for (size_t offset = 0; offset < 16; offset++) {
+            for (size_t size = 0; size <= MAX_LENGTH; size++) {
+                // 范围前后都是c，范围内没有c
+                char *s = prepare(offset, size, c);
+                s[size] = c;
+                TEST_STRING(memchr(s, c, size) == NULL, offset, size, size)
+                TEST_STRING(memrchr(s, c, size) == NULL, offset, size, size)
+                for (size_t position = 0; position < size; position++) {
+                    char saved = s[position];
+                    s[position] = c;
+                    TEST_STRING(memchr(s, c, size) == s + position, offset, size, position)
+                    TEST_STRING(memrchr(s, c, size) == s + position, offset, size, position)
+                    // 再放一个c，memchr找第一个，memrchr找最后一个
+                    if (position + 1 < size) {
+                        s[size - 1] = c;
+                        TEST_STRING(memchr(s, c, size) == s + position, offset, size, position)
+                        TEST_STRING(memrchr(s, c, size) == s + size - 1, offset, size, position)
+                        s[size - 1] = (char)('a' + (size - 1) % 26);
+                    }
+                    s[position] = saved;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * size为SIZE_MAX时，加上起始地址的对齐偏移不能溢出
+ */
+static void test_memchr_unbounded()
+{
+    for (size_t offset = 0; offset < 16; offset++) {
+        for (size_t position = 0; position <= MAX_LENGTH; position++) {
+            char *s = prepare(offset, MAX_LENGTH, '#');
+            s[position] = '#';
+            TEST_STRING(memchr(s, '#', SIZE_MAX) == s + position, offset, SIZE_MAX, position)
+        }
+    }
+}
+
+static void test_strcmp()
+{
+    for (size_t offsetA = 0; offsetA < 8; offsetA++) {
+        for (size_t offsetB = 0; offsetB < 8; offsetB++) {
+            for (size_t length = 0; length <= MAX_LENGTH; length++) {
+                char *a = prepare(offsetA, length, 'p');
+                char *b = other + offsetB;
+                memcpy(b, a, length + 1);
+                // 0之后的内容不同，比较必须在0处结束
+                memset(b + length + 1, 'q', sizeof(other) - offsetB - length - 1);
+                TEST_STRING(strcmp(a, b) == 0, offsetA, length, offsetB)
+                TEST_STRING(strncmp(a, b, SIZE_MAX) == 0, offsetA, length, offsetB)
+
+                for (size_t position = 0; position <= length; position++) {
+                    char saved = b[position];
+                    // 依次测试较大的无符号字节、较小的字节和提前结束
+                    const char values[] = {(char)0xF0, '\x01', '\0'};
+                    for (size_t v = 0; v < sizeof(values); v++) {
+                        if (values[v] == saved) {
+                            continue;
+                        }
+                        b[position] = values[v];
+                        int expected = (unsigned char)saved < (unsigned char)values[v] ? -1 : 1;
+                        TEST_STRING(sign(strcmp(a, b)) == expected, offsetA, length, position)
+                        TEST_STRING(sign(strcmp(b, a)) == -expected, offsetA, length, position)
+                        TEST_STRING(strncmp(a, b, position) == 0, offsetA, length, position)
+                        TEST_STRING(sign(strncmp(a, b, position + 1)) == expected, offsetA, length, position)
+                        TEST_STRING(sign(strncmp(b, a, SIZE_MAX)) == -expected, offsetA, length, position)
+                    }
+                    b[position] = saved;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * 字符串的0位于页的最后一个字节，下一页没有映射，读取越过页末会产生缺页异常
+ */
+static void test_page_end()
+{
+    char *page = mmap(NULL, 2 * PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED) {
+        test_count++;
+        test_failed++;
+        printf("* FAIL: line %d, mmap failed\n", __LINE__);
+        return;
+    }
+    munmap(page + PAGE_SIZE, PAGE_SIZE);
+
+    for (size_t length = 0; length <= MAX_LENGTH; length++) {
+        char *s = page + PAGE_SIZE - 1 - length;
+        for (size_t i = 0; i < length; i++) {
+            s[i] = (char)('a' + i % 26);
+        }
+        s[length] = '\0';
+        char *copy = prepare(length % 16, length, 'p');
+
+        TEST_STRING(strlen(s) == length, s - page, length, length)
+        TEST_STRING(strchr(s, '#') == NULL, s - page, length, length)
+        TEST_STRING(strchr(s, '\0') == s + length, s - page, length, length)
+        TEST_STRING(memchr(s, '#', length + 1) == NULL, s - page, length, length)
+        TEST_STRING(memchr(s, '\0', SIZE_MAX) == s + length, s - page, length, length)
+        TEST_STRING(memrchr(s, '#', length + 1) == NULL, s - page, length, length)
+        TEST_STRING(strcmp(s, copy) == 0, s - page, length, length)
+        TEST_STRING(strcmp(copy, s) == 0, s - page, length, length)
+        TEST_STRING(strncmp(s, copy, SIZE_MAX) == 0, s - page, length, length)
+    }
+    munmap(page, PAGE_SIZE);
+}
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    test_strlen();
+    test_strchr();
+    test_memchr();
+    test_memchr_unbounded();
+    test_strcmp();
+    test_page_end();
+    printf("Test: %d/%d\n", test_count - test_failed, test_count);
+    return 0;
+}